@@ -0,0 +1,348 @@
+// Microbenchmarks for the hot paths of the library.
+//
+//   metrics_benchmark [--quick] [--filter SUBSTRING] [--json FILE] [--baseline FILE] [--tolerance FRACTION]
+//
+// Every result reports ns/op, ops/s and latency percentiles. Per-op latencies are sampled over
+// small batches of operations so that timer overhead does not dominate. --json writes one result
+// object per line; --baseline compares ns/op against such a file and exits with status 2 when a
+// result is slower than the baseline by more than the tolerance (default 0.10).
+
+#include "../include/metrics_logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kBatchSize = 256;
+
+struct Options {
+    bool quick = false;
+    std::string filter;
+    std::string json_path;
+    std::string baseline_path;
+    double tolerance = 0.10;
+};
+
+struct Result {
+    std::string id;
+    uint64_t ops = 0;
+    double seconds = 0;
+    std::vector<double> samples_ns;
+
+    double NsPerOp() const {
+        return ops == 0 ? 0 : seconds * 1e9 / static_cast<double>(ops);
+    }
+
+    double OpsPerSecond() const {
+        return seconds == 0 ? 0 : static_cast<double>(ops) / seconds;
+    }
+
+    double Percentile(double p) const {
+        if (samples_ns.empty()) {
+            return 0;
+        }
+        auto sorted = samples_ns;
+        std::sort(sorted.begin(), sorted.end());
+        auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+        return sorted[index];
+    }
+};
+
+class NullSink : public metrics::ISink {
+public:
+    explicit NullSink(metrics::Format format) : format_(format) {
+    }
+
+    metrics::Format GetFormat() const override {
+        return format_;
+    }
+
+    void Write(const metrics::SharedBuffer& buffer) override {
+        bytes_ += buffer->size();
+    }
+
+private:
+    const metrics::Format format_;
+    std::atomic_size_t bytes_{0};
+};
+
+// Runs op(thread_index) ops_per_thread times on each of num_threads threads started together.
+// ns/op and ops/s are aggregate (wall time over all operations); percentiles are per thread.
+template <class Op>
+Result RunThreaded(std::string id, size_t num_threads, size_t ops_per_thread, Op op) {
+    std::vector<std::vector<double>> samples(num_threads);
+    std::atomic_size_t ready{0};
+    std::atomic_bool go{false};
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            samples[t].reserve(ops_per_thread / kBatchSize + 1);
+            ++ready;
+            while (!go.load()) {
+            }
+            for (size_t done = 0; done < ops_per_thread; done += kBatchSize) {
+                size_t batch = std::min(kBatchSize, ops_per_thread - done);
+                auto start = Clock::now();
+                for (size_t i = 0; i < batch; ++i) {
+                    op(t);
+                }
+                auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                samples[t].push_back(elapsed / static_cast<double>(batch));
+            }
+        });
+    }
+
+    while (ready.load() != num_threads) {
+    }
+    auto start = Clock::now();
+    go.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    Result result{std::move(id), num_threads * ops_per_thread, std::chrono::duration<double>(Clock::now() - start).count(), {}};
+    for (auto& thread_samples : samples) {
+        result.samples_ns.insert(result.samples_ns.end(), thread_samples.begin(), thread_samples.end());
+    }
+    return result;
+}
+
+// Times every call of op() individually; ops_per_call scales the result to per-item numbers.
+template <class Op>
+Result RunSerial(std::string id, size_t iterations, size_t ops_per_call, Op op) {
+    Result result{std::move(id), 0, 0, {}};
+    result.samples_ns.reserve(iterations);
+    for (size_t i = 0; i < iterations; ++i) {
+        auto start = Clock::now();
+        op();
+        auto elapsed = Clock::now() - start;
+        result.seconds += std::chrono::duration<double>(elapsed).count();
+        result.samples_ns.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(ops_per_call));
+    }
+    result.ops = iterations * ops_per_call;
+    return result;
+}
+
+class Suite {
+public:
+    explicit Suite(Options options) : options_(std::move(options)) {
+    }
+
+    bool Enabled(const std::string& id) const {
+        return options_.filter.empty() || id.find(options_.filter) != std::string::npos;
+    }
+
+    size_t Scale(size_t full) const {
+        return options_.quick ? std::max<size_t>(full / 20, kBatchSize) : full;
+    }
+
+    void Add(Result result) {
+        std::cout << std::left << std::setw(48) << result.id << std::right << std::fixed << std::setprecision(1) << std::setw(12) << result.NsPerOp() << std::setw(16)
+                  << std::setprecision(0) << result.OpsPerSecond() << std::setprecision(1) << std::setw(10) << result.Percentile(0.5) << std::setw(10) << result.Percentile(0.9)
+                  << std::setw(10) << result.Percentile(0.99) << std::endl;
+        results_.push_back(std::move(result));
+    }
+
+    void PrintHeader() const {
+        std::cout << std::left << std::setw(48) << "benchmark" << std::right << std::setw(12) << "ns/op" << std::setw(16) << "ops/s" << std::setw(10) << "p50 ns" << std::setw(10)
+                  << "p90 ns" << std::setw(10) << "p99 ns" << std::endl;
+    }
+
+    bool WriteJson() const {
+        std::ofstream out(options_.json_path);
+        if (!out.is_open()) {
+            return false;
+        }
+        out << "[\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const auto& r = results_[i];
+            out << std::setprecision(6) << "  {\"id\": \"" << r.id << "\", \"ops\": " << r.ops << ", \"seconds\": " << r.seconds << ", \"ns_per_op\": " << r.NsPerOp()
+                << ", \"ops_per_sec\": " << r.OpsPerSecond() << ", \"p50_ns\": " << r.Percentile(0.5) << ", \"p90_ns\": " << r.Percentile(0.9) << ", \"p99_ns\": " << r.Percentile(0.99)
+                << ", \"p999_ns\": " << r.Percentile(0.999) << "}" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        out << "]\n";
+        return out.good();
+    }
+
+    // Reads files written by WriteJson: one result object per line.
+    bool CompareWithBaseline() const {
+        std::ifstream in(options_.baseline_path);
+        if (!in.is_open()) {
+            std::cerr << "cannot open baseline " << options_.baseline_path << std::endl;
+            return false;
+        }
+        std::map<std::string, double> baseline;
+        std::string line;
+        while (std::getline(in, line)) {
+            auto id_pos = line.find("\"id\": \"");
+            auto ns_pos = line.find("\"ns_per_op\": ");
+            if (id_pos == std::string::npos || ns_pos == std::string::npos) {
+                continue;
+            }
+            id_pos += 7;
+            baseline[line.substr(id_pos, line.find('"', id_pos) - id_pos)] = std::strtod(line.c_str() + ns_pos + 13, nullptr);
+        }
+
+        bool ok = true;
+        std::cout << std::endl << "Comparison with " << options_.baseline_path << " (tolerance " << options_.tolerance * 100 << "%)" << std::endl;
+        for (const auto& result : results_) {
+            auto it = baseline.find(result.id);
+            if (it == baseline.end() || it->second <= 0) {
+                continue;
+            }
+            double change = result.NsPerOp() / it->second - 1;
+            bool regressed = change > options_.tolerance;
+            ok = ok && !regressed;
+            std::cout << std::left << std::setw(48) << result.id << std::right << std::showpos << std::setprecision(1) << std::setw(10) << change * 100 << "%" << std::noshowpos
+                      << (regressed ? "  REGRESSION" : "") << std::endl;
+        }
+        return ok;
+    }
+
+private:
+    Options options_;
+    std::vector<Result> results_;
+};
+
+const std::vector<size_t> kThreadCounts{1, 2, 4, 8};
+
+void BenchCounter(Suite& suite) {
+    for (size_t threads : kThreadCounts) {
+        std::string id = "counter_increment/threads=" + std::to_string(threads);
+        if (!suite.Enabled(id)) {
+            continue;
+        }
+        metrics::Counter counter("bench");
+        suite.Add(RunThreaded(id, threads, suite.Scale(2000000), [&counter](size_t) { counter.Increment(); }));
+    }
+}
+
+void BenchGauge(Suite& suite) {
+    for (size_t threads : kThreadCounts) {
+        std::string id = "gauge_set/threads=" + std::to_string(threads);
+        if (!suite.Enabled(id)) {
+            continue;
+        }
+        metrics::Gauge gauge("bench");
+        suite.Add(RunThreaded(id, threads, suite.Scale(2000000), [&gauge](size_t thread) { gauge.Set(static_cast<double>(thread)); }));
+    }
+}
+
+template <size_t Size>
+void BenchQueue(Suite& suite) {
+    for (size_t threads : kThreadCounts) {
+        std::string id = "queue_enqueue_dequeue/size=" + std::to_string(Size) + "/threads=" + std::to_string(threads);
+        if (!suite.Enabled(id)) {
+            continue;
+        }
+        auto queue = std::make_unique<metrics::MPMCBoundedQueue<int64_t, Size>>();
+        suite.Add(RunThreaded(id, threads, suite.Scale(1000000), [&queue](size_t thread) {
+            int64_t value = static_cast<int64_t>(thread);
+            queue->Enqueue(value);
+            queue->Dequeue(value);
+        }));
+    }
+}
+
+// Flush is CollectMetrics + WriteSnapshots: GetAndReset every metric, pass snapshots through
+// the queue, format once and hand the buffer to the sinks. Results are per metric.
+void BenchFlush(Suite& suite) {
+    for (size_t registry_size : {16, 256, 4096}) {
+        std::string id = "logger_flush/metrics=" + std::to_string(registry_size);
+        if (!suite.Enabled(id)) {
+            continue;
+        }
+
+        metrics::SharedCollector collector;
+        metrics::MetricsLogger logger(collector, std::chrono::hours(1));
+        logger.AddSink(std::make_shared<NullSink>(metrics::Format::kText), {.max_pending = 1 << 20});
+
+        std::vector<std::shared_ptr<metrics::Counter>> counters;
+        for (size_t i = 0; i < registry_size; ++i) {
+            counters.push_back(std::make_shared<metrics::Counter>("bench_counter_" + std::to_string(i)));
+            logger.RegisterMetric(counters.back());
+        }
+
+        suite.Add(RunSerial(id, suite.Scale(2000) / (registry_size >= 4096 ? 10 : 1), registry_size, [&] {
+            for (auto& counter : counters) {
+                counter->Increment();
+            }
+            logger.Flush();
+        }));
+        logger.Stop();
+    }
+}
+
+void BenchFormat(Suite& suite) {
+    for (auto [format, name] : {std::pair{metrics::Format::kText, "text"}, std::pair{metrics::Format::kBinary, "binary"}}) {
+        for (size_t batch_size : {16, 256, 4096}) {
+            std::string id = std::string("format_") + name + "/metrics=" + std::to_string(batch_size);
+            if (!suite.Enabled(id)) {
+                continue;
+            }
+            auto now = std::chrono::system_clock::now();
+            std::vector<metrics::MetricSnapshot> batch;
+            for (size_t i = 0; i < batch_size; ++i) {
+                batch.push_back({"bench_metric_" + std::to_string(i), i % 2 ? metrics::MetricValue(static_cast<int64_t>(i)) : metrics::MetricValue(0.5 * static_cast<double>(i)), now});
+            }
+            suite.Add(RunSerial(id, suite.Scale(2000) / (batch_size >= 4096 ? 10 : 1), batch_size, [&] { metrics::FormatBatch(format, batch); }));
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--quick") {
+            options.quick = true;
+        } else if (arg == "--filter" && has_value) {
+            options.filter = argv[++i];
+        } else if (arg == "--json" && has_value) {
+            options.json_path = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            options.baseline_path = argv[++i];
+        } else if (arg == "--tolerance" && has_value) {
+            options.tolerance = std::strtod(argv[++i], nullptr);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--quick] [--filter SUBSTRING] [--json FILE] [--baseline FILE] [--tolerance FRACTION]" << std::endl;
+            return 1;
+        }
+    }
+
+    Suite suite(options);
+    suite.PrintHeader();
+    BenchCounter(suite);
+    BenchGauge(suite);
+    BenchQueue<64>(suite);
+    BenchQueue<1024>(suite);
+    BenchQueue<4096>(suite);
+    BenchFlush(suite);
+    BenchFormat(suite);
+
+    if (!options.json_path.empty() && !suite.WriteJson()) {
+        std::cerr << "cannot write " << options.json_path << std::endl;
+        return 1;
+    }
+    if (!options.baseline_path.empty() && !suite.CompareWithBaseline()) {
+        return 2;
+    }
+    return 0;
+}
@@ -1,4 +1,12 @@
 #include "../include/metrics_logger.hpp"
+#include "../include/unix_socket_sink.hpp"
+#include "../include/log_reader.hpp"
+#include "../include/checkpoint.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include <thread>
 #include <chrono>
@@ -7,7 +15,13 @@
 #include <cassert>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
 
 void TestQueueEnqueue() {
     std::cout << "Testing Queue Enqueue..." << std::endl;
@@ -448,6 +462,939 @@ void TestQueueSizeAssertion() {
     std::cout << "Queue size assertion tests passed!" << std::endl;
 }
 
+int ListenUnixSocket(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(fd >= 0);
+    assert(bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0);
+    assert(listen(fd, 4) == 0);
+    return fd;
+}
+
+bool ReadFrame(int fd, std::vector<metrics::MetricSnapshot>& batch) {
+    metrics::FrameHeader header;
+    if (recv(fd, header.data(), header.size(), MSG_WAITALL) != static_cast<ssize_t>(header.size())) {
+        return false;
+    }
+    std::string payload(metrics::DecodeFrameHeader(header), '\0');
+    if (recv(fd, payload.data(), payload.size(), MSG_WAITALL) != static_cast<ssize_t>(payload.size())) {
+        return false;
+    }
+    return metrics::DecodeBinary(payload, batch);
+}
+
+void TestBinaryFormatRoundTrip() {
+    std::cout << "Testing binary format round trip..." << std::endl;
+
+    auto now = std::chrono::system_clock::now();
+    std::vector<metrics::MetricSnapshot> batch{{"requests", int64_t{42}, now}, {"cpu", 0.97, now}, {"", int64_t{-7}, now}};
+
+    std::string payload = metrics::EncodeBinary(batch);
+    std::vector<metrics::MetricSnapshot> decoded;
+    assert(metrics::DecodeBinary(payload, decoded));
+    assert(decoded.size() == 3);
+    assert(decoded[0].name == "requests" && std::get<int64_t>(decoded[0].value) == 42);
+    assert(decoded[1].name == "cpu" && std::get<double>(decoded[1].value) == 0.97);
+    assert(decoded[2].name.empty() && std::get<int64_t>(decoded[2].value) == -7);
+    assert(decoded[0].timestamp == now);
+
+    assert(!metrics::DecodeBinary(std::string_view(payload).substr(0, payload.size() - 1), decoded));
+    assert(metrics::DecodeFrameHeader(metrics::EncodeFrameHeader(123456)) == 123456);
+
+    std::cout << "Binary format round trip tests passed!" << std::endl;
+}
+
+void TestUnixSocketSink() {
+    std::cout << "Testing UnixSocketSink..." << std::endl;
+
+    const std::string socket_path = "test_metrics_sink.sock";
+    int listen_fd = ListenUnixSocket(socket_path);
+
+    {
+        metrics::MetricsLogger logger("test_socket_metrics.log", std::chrono::milliseconds(50));
+        auto sink = std::make_shared<metrics::UnixSocketSink>(socket_path);
+        logger.AddSink(sink);
+
+        auto counter = std::make_shared<metrics::Counter>("socket_requests");
+        logger.RegisterMetric(counter);
+        counter->Increment(17);
+
+        int fd = accept(listen_fd, nullptr, nullptr);
+        assert(fd >= 0);
+
+        std::vector<metrics::MetricSnapshot> batch;
+        assert(ReadFrame(fd, batch));
+        assert(batch.size() == 1);
+        assert(batch[0].name == "socket_requests");
+        assert(std::get<int64_t>(batch[0].value) == 17);
+        assert(sink->Connected());
+
+        logger.Stop();
+        close(fd);
+    }
+
+    close(listen_fd);
+    unlink(socket_path.c_str());
+
+    std::cout << "UnixSocketSink tests passed!" << std::endl;
+}
+
+void TestUnixSocketSinkReconnect() {
+    std::cout << "Testing UnixSocketSink reconnect and backlog..." << std::endl;
+
+    const std::string socket_path = "test_metrics_reconnect.sock";
+    unlink(socket_path.c_str());
+
+    auto now = std::chrono::system_clock::now();
+    std::vector<metrics::MetricSnapshot> batch{{"backlog", int64_t{1}, now}};
+
+    metrics::UnixSocketSink sink(socket_path, 256);
+    for (int i = 0; i < 20; ++i) {
+        batch[0].value = int64_t{i};
+        sink.Write(metrics::FormatBatch(metrics::Format::kBinary, batch));
+    }
+    assert(!sink.Connected());
+    assert(sink.BacklogBytes() <= 256);
+    assert(sink.DroppedFrames() > 0);
+
+    int listen_fd = ListenUnixSocket(socket_path);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    batch[0].value = int64_t{100};
+    sink.Write(metrics::FormatBatch(metrics::Format::kBinary, batch));
+    assert(sink.Connected());
+    assert(sink.BacklogBytes() == 0);
+
+    int fd = accept(listen_fd, nullptr, nullptr);
+    assert(fd >= 0);
+
+    std::vector<metrics::MetricSnapshot> received;
+    int64_t last = -1;
+    while (last != 100) {
+        assert(ReadFrame(fd, received));
+        int64_t value = std::get<int64_t>(received[0].value);
+        assert(value > last);
+        last = value;
+    }
+
+    close(fd);
+    close(listen_fd);
+    unlink(socket_path.c_str());
+
+    std::cout << "UnixSocketSink reconnect tests passed!" << std::endl;
+}
+
+class RecordingSink : public metrics::ISink {
+public:
+    explicit RecordingSink(metrics::Format format, std::chrono::milliseconds delay = std::chrono::milliseconds(0)) : format_(format), delay_(delay) {
+    }
+
+    metrics::Format GetFormat() const override {
+        return format_;
+    }
+
+    void Write(const metrics::SharedBuffer& buffer) override {
+        std::this_thread::sleep_for(delay_);
+        std::lock_guard lock(mutex_);
+        buffers_.push_back(buffer);
+    }
+
+    std::vector<metrics::SharedBuffer> Buffers() {
+        std::lock_guard lock(mutex_);
+        return buffers_;
+    }
+
+private:
+    const metrics::Format format_;
+    const std::chrono::milliseconds delay_;
+    std::mutex mutex_;
+    std::vector<metrics::SharedBuffer> buffers_;
+};
+
+void TestFanOutSharesBuffers() {
+    std::cout << "Testing FanOut buffer sharing..." << std::endl;
+
+    auto text1 = std::make_shared<RecordingSink>(metrics::Format::kText);
+    auto text2 = std::make_shared<RecordingSink>(metrics::Format::kText);
+    auto binary = std::make_shared<RecordingSink>(metrics::Format::kBinary);
+
+    metrics::FanOut fan_out;
+    fan_out.AddSink(text1);
+    fan_out.AddSink(text2);
+    fan_out.AddSink(binary);
+
+    std::vector<metrics::MetricSnapshot> batch{{"shared", int64_t{5}, std::chrono::system_clock::now()}};
+    fan_out.Publish(batch);
+    fan_out.Publish({});
+    fan_out.Stop();
+
+    assert(text1->Buffers().size() == 1);
+    assert(text2->Buffers().size() == 1);
+    assert(binary->Buffers().size() == 1);
+    assert(text1->Buffers()[0].get() == text2->Buffers()[0].get());
+    assert(text1->Buffers()[0]->find("\"shared\" 5") != std::string::npos);
+
+    std::vector<metrics::MetricSnapshot> decoded;
+    assert(metrics::DecodeBinary(*binary->Buffers()[0], decoded));
+    assert(decoded.size() == 1 && decoded[0].name == "shared");
+
+    std::cout << "FanOut buffer sharing tests passed!" << std::endl;
+}
+
+void TestFanOutSlowSink() {
+    std::cout << "Testing FanOut with a slow sink..." << std::endl;
+
+    auto fast = std::make_shared<RecordingSink>(metrics::Format::kText);
+    auto slow = std::make_shared<RecordingSink>(metrics::Format::kText, std::chrono::milliseconds(20));
+    auto slow_newest = std::make_shared<RecordingSink>(metrics::Format::kText, std::chrono::milliseconds(20));
+
+    metrics::FanOut fan_out;
+    fan_out.AddSink(fast, {.max_pending = 64});
+    fan_out.AddSink(slow, {.max_pending = 2, .policy = metrics::BackpressurePolicy::kDropOldest});
+    fan_out.AddSink(slow_newest, {.max_pending = 2, .policy = metrics::BackpressurePolicy::kDropNewest});
+
+    const int batches = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < batches; ++i) {
+        std::vector<metrics::MetricSnapshot> batch{{"value", int64_t{i}, std::chrono::system_clock::now()}};
+        fan_out.Publish(batch);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    assert(elapsed < std::chrono::milliseconds(100));
+
+    fan_out.Stop();
+
+    assert(fast->Buffers().size() == batches);
+    assert(slow->Buffers().size() < batches);
+    assert(slow->Buffers().back()->find("\"value\" 19") != std::string::npos);
+    assert(slow_newest->Buffers().size() < batches);
+    assert(slow_newest->Buffers().back()->find("\"value\" 19") == std::string::npos);
+    assert(fan_out.Dropped() > 0);
+
+    std::cout << "FanOut slow sink tests passed!" << std::endl;
+}
+
+size_t CountThreads() {
+    return static_cast<size_t>(std::distance(std::filesystem::directory_iterator("/proc/self/task"), std::filesystem::directory_iterator()));
+}
+
+void TestLoggerThreadCount() {
+    std::cout << "Testing Logger thread count..." << std::endl;
+
+    const std::string test_file = "test_thread_count.log";
+    size_t before = CountThreads();
+    {
+        // The default file is written inline on the logger's thread.
+        metrics::MetricsLogger logger(test_file, std::chrono::milliseconds(20));
+        assert(CountThreads() == before + 1);
+
+        // A second sink moves both onto worker threads.
+        auto sink = std::make_shared<RecordingSink>(metrics::Format::kText);
+        logger.AddSink(sink);
+        assert(CountThreads() == before + 3);
+
+        auto counter = std::make_shared<metrics::Counter>("thread_count_counter");
+        logger.RegisterMetric(counter);
+        counter->Increment();
+        logger.Stop();
+        assert(!sink->Buffers().empty());
+    }
+    std::ifstream in(test_file);
+    std::string line;
+    assert(std::getline(in, line) && line.find("\"thread_count_counter\" 1") != std::string::npos);
+    std::remove(test_file.c_str());
+
+    std::cout << "Logger thread count tests passed!" << std::endl;
+}
+
+void TestLoggerWithoutFile() {
+    std::cout << "Testing Logger without default file..." << std::endl;
+
+    auto sink = std::make_shared<RecordingSink>(metrics::Format::kText);
+    auto gauge = std::make_shared<metrics::Gauge>("sink_only_gauge");
+
+    {
+        metrics::MetricsLogger logger(std::chrono::milliseconds(50));
+        logger.AddSink(sink);
+        logger.RegisterMetric(gauge);
+        gauge->Set(2.5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    auto buffers = sink->Buffers();
+    assert(!buffers.empty());
+    assert(buffers[0]->find("\"sink_only_gauge\" 2.5") != std::string::npos);
+
+    std::cout << "Logger without default file tests passed!" << std::endl;
+}
+
+void TestSharedCollectorTasks() {
+    std::cout << "Testing SharedCollector tasks..." << std::endl;
+
+    metrics::SharedCollector collector;
+    std::atomic_int first{0};
+    std::atomic_int second{0};
+    std::atomic_int posted{0};
+
+    auto first_id = collector.Schedule(std::chrono::milliseconds(20), [&first] { ++first; });
+    auto second_id = collector.Schedule(std::chrono::milliseconds(20), [&second] { ++second; });
+    collector.Post([&posted] { ++posted; });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    collector.Cancel(first_id);
+    int first_after_cancel = first.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+
+    assert(first_after_cancel >= 3);
+    assert(first.load() == first_after_cancel);
+    assert(second.load() > first_after_cancel);
+    assert(posted.load() == 1);
+
+    collector.Cancel(second_id);
+    collector.Stop();
+    collector.Post([&posted] { ++posted; });
+    assert(posted.load() == 2);
+
+    std::cout << "SharedCollector tasks tests passed!" << std::endl;
+}
+
+void TestSharedCollectorSlowSink() {
+    std::cout << "Testing SharedCollector ticks with a slow sink..." << std::endl;
+
+    metrics::SharedCollector collector;
+    auto slow = std::make_shared<RecordingSink>(metrics::Format::kText, std::chrono::milliseconds(400));
+    metrics::MetricsLogger logger(collector, std::chrono::milliseconds(20));
+    logger.AddSink(slow);
+    auto counter = std::make_shared<metrics::Counter>("slow_sink_counter");
+    logger.RegisterMetric(counter);
+
+    std::atomic_int ticks{0};
+    auto id = collector.Schedule(std::chrono::milliseconds(20), [&ticks] { ++ticks; });
+    counter->Increment();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    counter->Increment();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // Ticks keep running while the delivery thread is stuck in the sink.
+    assert(ticks.load() >= 5);
+    collector.Cancel(id);
+    logger.Stop();
+    assert(slow->Buffers().size() >= 2);
+
+    std::cout << "SharedCollector slow sink tests passed!" << std::endl;
+}
+
+void TestConcurrentFlush() {
+    std::cout << "Testing concurrent Flush calls..." << std::endl;
+
+    metrics::SharedCollector collector;
+    auto sink = std::make_shared<RecordingSink>(metrics::Format::kText);
+    metrics::MetricsLogger logger(collector, std::chrono::milliseconds(1));
+    logger.SetCollectionMode(metrics::CollectionMode::kCumulative);
+    logger.AddSink(sink, {.max_pending = 100000});
+
+    const size_t num_metrics = 50;
+    std::vector<std::shared_ptr<metrics::Counter>> counters;
+    for (size_t i = 0; i < num_metrics; ++i) {
+        counters.push_back(std::make_shared<metrics::Counter>("flush_" + std::to_string(i)));
+        logger.RegisterMetric(counters.back());
+    }
+
+    std::vector<std::thread> flushers;
+    for (int t = 0; t < 4; ++t) {
+        flushers.emplace_back([&logger] {
+            for (int i = 0; i < 200; ++i) {
+                logger.Flush();
+            }
+        });
+    }
+    for (auto& flusher : flushers) {
+        flusher.join();
+    }
+    logger.Stop();
+
+    // Every collection reports all metrics, so a batch split between two flushes would show up
+    // as a line with fewer of them.
+    auto buffers = sink->Buffers();
+    assert(buffers.size() >= 800);
+    for (const auto& buffer : buffers) {
+        size_t found = 0;
+        for (size_t pos = buffer->find("\"flush_"); pos != std::string::npos; pos = buffer->find("\"flush_", pos + 1)) {
+            ++found;
+        }
+        assert(found == num_metrics);
+    }
+
+    std::cout << "Concurrent Flush tests passed!" << std::endl;
+}
+
+void TestSharedCollectorLoggers() {
+    std::cout << "Testing loggers on a SharedCollector..." << std::endl;
+
+    const std::vector<std::string> files{"test_shared_a.log", "test_shared_b.log", "test_shared_c.log"};
+    for (const auto& file : files) {
+        std::remove(file.c_str());
+    }
+
+    for (size_t num_threads : {1, 2}) {
+        metrics::SharedCollector collector(num_threads);
+        std::vector<std::unique_ptr<metrics::MetricsLogger>> loggers;
+        std::vector<std::shared_ptr<metrics::Counter>> counters;
+
+        for (const auto& file : files) {
+            loggers.push_back(std::make_unique<metrics::MetricsLogger>(file, collector, std::chrono::milliseconds(50)));
+            counters.push_back(std::make_shared<metrics::Counter>("counter_" + file));
+            loggers.back()->RegisterMetric(counters.back());
+        }
+
+        for (int round = 0; round < 3; ++round) {
+            for (auto& counter : counters) {
+                counter->Increment();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(60));
+        }
+
+        for (auto& logger : loggers) {
+            logger->Stop();
+        }
+    }
+
+    for (const auto& file : files) {
+        std::ifstream in(file);
+        assert(in.is_open());
+
+        std::string line;
+        int64_t total = 0;
+        while (std::getline(in, line)) {
+            auto pos = line.find("\"counter_" + file + "\" ");
+            assert(pos != std::string::npos);
+            for (const auto& other : files) {
+                assert(other == file || line.find(other) == std::string::npos);
+            }
+            total += std::stoll(line.substr(pos + file.size() + 11));
+        }
+        assert(total == 6);
+    }
+
+    std::cout << "Loggers on a SharedCollector tests passed!" << std::endl;
+}
+
+void TestCompressorRoundTrip() {
+    std::cout << "Testing compressor round trip..." << std::endl;
+
+    std::string text;
+    for (int i = 0; i < 2000; ++i) {
+        text += "2026-10-18 14:00:00.000 \"CPU\" 0." + std::to_string(i % 97) + " \"HTTP requests RPS\" " + std::to_string(i) + "\n";
+    }
+    std::mt19937 gen(42);
+    std::string noise(5000, '\0');
+    for (auto& c : noise) {
+        c = static_cast<char>(gen());
+    }
+
+    for (const std::string& input : {std::string(), std::string("abc"), std::string(1000, 'x'), text, noise}) {
+        std::string compressed = metrics::CompressBlock(input);
+        std::string output;
+        assert(metrics::DecompressBlock(compressed, input.size(), output));
+        assert(output == input);
+    }
+    assert(metrics::CompressBlock(text).size() < text.size() / 4);
+
+    std::string output;
+    std::string corrupted = metrics::CompressBlock(text).substr(0, 100);
+    assert(!metrics::DecompressBlock(corrupted, text.size(), output));
+
+    // One literal, then a match whose length bytes would expand to about 1 MB.
+    std::string hostile("\x1f" "a" "\x01\x00", 4);
+    hostile += std::string(4000, static_cast<char>(255));
+    hostile.push_back('\0');
+    output.clear();
+    assert(!metrics::DecompressBlock(hostile, 16, output));
+    assert(output.size() <= 16);
+
+    std::cout << "Compressor round trip tests passed!" << std::endl;
+}
+
+std::vector<std::string> ListSegments(const std::string& filename) {
+    std::vector<std::string> segments;
+    for (const auto& entry : std::filesystem::directory_iterator(".")) {
+        std::string name = entry.path().filename().string();
+        if (name.starts_with(filename + ".")) {
+            segments.push_back(name);
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+void RemoveSegments(const std::string& filename) {
+    std::remove(filename.c_str());
+    for (const auto& segment : ListSegments(filename)) {
+        std::remove(segment.c_str());
+    }
+}
+
+void TestFileSinkSizeRotation() {
+    std::cout << "Testing FileSink size rotation..." << std::endl;
+
+    const std::string test_file = "test_rotation.log";
+    RemoveSegments(test_file);
+
+    std::string expected;
+    {
+        metrics::FileSink sink(test_file, {.max_bytes = 200, .compress = true});
+        assert(std::filesystem::exists(test_file + ".next"));
+        for (int i = 0; i < 40; ++i) {
+            std::string line = "2026-10-18 14:00:00.000 \"rotation\" " + std::to_string(i) + "\n";
+            expected += line;
+            sink.Write(std::make_shared<const std::string>(line));
+            assert(std::filesystem::file_size(test_file) <= 200);
+        }
+    }
+    assert(!std::filesystem::exists(test_file + ".next"));
+
+    // Shutdown does not wait for the compressor; reopening the file queues what it left behind.
+    auto uncompressed = [&test_file] {
+        auto segments = ListSegments(test_file);
+        return std::ranges::count_if(segments, [](const std::string& segment) { return !segment.ends_with(".mlz"); });
+    };
+    {
+        metrics::FileSink sink(test_file, {.max_bytes = 200, .compress = true});
+        for (int i = 0; i < 500 && uncompressed() > 1; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        // Only the new sink's .next remains.
+        assert(uncompressed() == 1);
+    }
+
+    std::string actual;
+    auto segments = ListSegments(test_file);
+    assert(segments.size() > 5);
+    for (const auto& segment : segments) {
+        assert(segment.ends_with(".mlz"));
+        std::string content;
+        assert(metrics::DecompressFile(segment, content));
+        assert(!content.empty() && content.size() <= 200);
+        actual += content;
+    }
+    std::ifstream active(test_file);
+    actual += std::string((std::istreambuf_iterator<char>(active)), std::istreambuf_iterator<char>());
+    assert(actual == expected);
+
+    RemoveSegments(test_file);
+
+    std::cout << "FileSink size rotation tests passed!" << std::endl;
+}
+
+void TestFileSinkPeriodRotation() {
+    std::cout << "Testing FileSink period rotation..." << std::endl;
+
+    const std::string test_file = "test_period_rotation.log";
+    RemoveSegments(test_file);
+
+    {
+        metrics::FileSink sink(test_file, {.period = std::chrono::seconds(1)});
+        struct stat st {};
+        assert(stat((test_file + ".next").c_str(), &st) == 0 && st.st_size == 0 && st.st_blocks > 0);
+        sink.Write(std::make_shared<const std::string>("first\n"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        sink.Write(std::make_shared<const std::string>("second\n"));
+    }
+
+    auto segments = ListSegments(test_file);
+    assert(segments.size() == 1);
+    std::ifstream archived(segments[0]);
+    std::string line;
+    assert(std::getline(archived, line) && line == "first");
+    std::ifstream active(test_file);
+    assert(std::getline(active, line) && line == "second");
+
+    RemoveSegments(test_file);
+
+    std::cout << "FileSink period rotation tests passed!" << std::endl;
+}
+
+void TestFileSinkSharedFile() {
+    std::cout << "Testing FileSink on an externally managed file..." << std::endl;
+
+    const std::string test_file = "test_shared_file.log";
+    std::remove(test_file.c_str());
+
+    // External copytruncate: closing the sink must not grow the file back.
+    {
+        metrics::FileSink sink(test_file);
+        sink.Write(std::make_shared<const std::string>(std::string(100, 'a') + "\n"));
+        std::filesystem::resize_file(test_file, 0);
+        sink.Write(std::make_shared<const std::string>("b\n"));
+    }
+    assert(std::filesystem::file_size(test_file) == 2);
+    std::remove(test_file.c_str());
+
+    // Two appenders on one path: neither truncates the other's data.
+    {
+        metrics::FileSink first(test_file);
+        metrics::FileSink second(test_file);
+        first.Write(std::make_shared<const std::string>("first writer line\n"));
+        second.Write(std::make_shared<const std::string>("second writer line\n"));
+        first.Write(std::make_shared<const std::string>("x\n"));
+    }
+    assert(std::filesystem::file_size(test_file) == 39);
+    std::remove(test_file.c_str());
+
+    std::cout << "FileSink external file tests passed!" << std::endl;
+}
+
+std::string SyntheticTimestamp(int tenths) {
+    char buffer[32];
+    int seconds = tenths / 10;
+    std::snprintf(buffer, sizeof(buffer), "2026-10-18 %02d:%02d:%02d.%03d", 14 + seconds / 3600, seconds / 60 % 60, seconds % 60, tenths % 10 * 100);
+    return buffer;
+}
+
+void TestLogReaderQuery() {
+    std::cout << "Testing LogReader time-range queries..." << std::endl;
+
+    const std::string active = "test_reader.log";
+    const std::string segment = "test_reader.log.20261018-140000-000";
+    RemoveSegments(active);
+
+    // 20 minutes of batches every 100 ms: the first 10 minutes in a compressed segment.
+    const int lines = 12000;
+    {
+        std::ofstream old_segment(segment);
+        std::ofstream current(active);
+        for (int i = 0; i < lines; ++i) {
+            auto& out = i < lines / 2 ? old_segment : current;
+            out << SyntheticTimestamp(i) << " \"CPU\" 0." << i % 10 << " \"HTTP requests RPS\" " << i << "\n";
+        }
+    }
+    assert(metrics::CompressFile(segment, segment + ".mlz"));
+    std::remove(segment.c_str());
+
+    for (int pass = 0; pass < 2; ++pass) {
+        // Like a shell glob over metrics.log*: cached *.idx files from the first pass are skipped.
+        auto paths = ListSegments(active);
+        paths.push_back(active);
+        metrics::LogReader reader(paths, 1024);
+        assert(reader.Segments().size() == 2);
+        assert(reader.Segments()[0]->Path() == segment + ".mlz");
+        assert(reader.Segments()[0]->Index().size() > 100);
+        assert(std::filesystem::exists(active + ".idx"));
+
+        std::vector<int64_t> values;
+        reader.Query("2026-10-18 14:09", "2026-10-18 14:11", "HTTP requests RPS", [&values](const metrics::MetricRecord& record) {
+            assert(record.timestamp >= "2026-10-18 14:09" && record.timestamp < "2026-10-18 14:11");
+            values.push_back(std::stoll(std::string(record.value)));
+        });
+        assert(values.size() == 1200);
+        assert(values.front() == 5400 && values.back() == 6599);
+        assert(std::is_sorted(values.begin(), values.end()));
+
+        size_t cpu = 0;
+        reader.Query("", "", "CPU", [&cpu](const metrics::MetricRecord&) { ++cpu; }, 1);
+        assert(cpu == lines);
+
+        size_t all = 0;
+        reader.Query("2026-10-18 14:19:59.900", "", "", [&all](const metrics::MetricRecord&) { ++all; });
+        assert(all == 2);
+
+        size_t none = 0;
+        reader.Query("2026-10-18 15", "", "", [&none](const metrics::MetricRecord&) { ++none; });
+        assert(none == 0);
+    }
+
+    {
+        // A corrupt cached index whose entry count overflows to the real payload size is
+        // rebuilt instead of being allocated. The count follows "MIDX1", size, mtime and stride.
+        const std::string index_path = active + ".idx";
+        size_t expected_entries = metrics::LogSegment(active, 1024).Index().size();
+        // One stray byte makes the payload no multiple of the entry size, so only a wrapped count matches it.
+        std::ofstream(index_path, std::ios::app | std::ios::binary) << 'x';
+        uint64_t payload = std::filesystem::file_size(index_path) - 37;
+        uint64_t inverse = 1;
+        for (int i = 0; i < 6; ++i) {
+            inverse *= 2 - 31 * inverse;
+        }
+        uint64_t forged_count = payload * inverse;
+        assert(forged_count * 31 == payload && forged_count > payload);
+        {
+            std::fstream index(index_path, std::ios::in | std::ios::out | std::ios::binary);
+            std::string bytes;
+            metrics::detail::PutLittleEndian<uint64_t>(bytes, forged_count);
+            index.seekp(29);
+            index.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+        assert(metrics::LogSegment(active, 1024).Index().size() == expected_entries);
+    }
+
+    RemoveSegments(active);
+
+    std::cout << "LogReader time-range query tests passed!" << std::endl;
+}
+
+void TestLogReaderNonMonotonic() {
+    std::cout << "Testing LogReader with a repeated hour..." << std::endl;
+
+    // Ten minutes logged twice, as when DST ends and local time repeats.
+    const std::string active = "test_reader_repeat.log";
+    RemoveSegments(active);
+    {
+        std::ofstream out(active);
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int i = 0; i < 6000; ++i) {
+                out << SyntheticTimestamp(i) << " \"CPU\" 0." << i % 10 << " \"pass\" " << pass << "\n";
+            }
+        }
+    }
+
+    metrics::LogReader reader({active}, 1024);
+    assert(reader.Segments().size() == 1);
+    assert(!reader.Segments()[0]->Monotonic());
+
+    std::vector<int> passes;
+    reader.Query("2026-10-18 14:05", "2026-10-18 14:06", "pass", [&passes](const metrics::MetricRecord& record) {
+        assert(record.timestamp >= "2026-10-18 14:05" && record.timestamp < "2026-10-18 14:06");
+        passes.push_back(std::stoi(std::string(record.value)));
+    });
+    assert(passes.size() == 1200);
+    assert(std::count(passes.begin(), passes.end(), 1) == 600);
+
+    // Also after the index was cached by the first reader.
+    size_t late = 0;
+    metrics::LogReader cached({active}, 1024);
+    assert(!cached.Segments()[0]->Monotonic());
+    cached.Query("2026-10-18 14:09:59", "", "pass", [&late](const metrics::MetricRecord&) { ++late; });
+    assert(late == 20);
+
+    RemoveSegments(active);
+
+    std::cout << "LogReader repeated hour tests passed!" << std::endl;
+}
+
+void TestParseLine() {
+    std::cout << "Testing log line parsing..." << std::endl;
+
+    std::vector<metrics::MetricRecord> records;
+    metrics::ParseLine("2026-10-18 14:00:00.123 \"CPU\" 0.97 \"HTTP requests RPS\" 42", [&records](const metrics::MetricRecord& record) { records.push_back(record); });
+    assert(records.size() == 2);
+    assert(records[0].timestamp == "2026-10-18 14:00:00.123");
+    assert(records[0].name == "CPU" && records[0].value == "0.97");
+    assert(records[1].name == "HTTP requests RPS" && records[1].value == "42");
+
+    records.clear();
+    metrics::ParseLine("garbage", [&records](const metrics::MetricRecord& record) { records.push_back(record); });
+    assert(records.empty());
+
+    std::cout << "Log line parsing tests passed!" << std::endl;
+}
+
+void TestLoggerDroppedSnapshots() {
+    std::cout << "Testing Logger dropped snapshots..." << std::endl;
+
+    auto sink = std::make_shared<RecordingSink>(metrics::Format::kText);
+    metrics::SharedCollector collector;
+    metrics::MetricsLogger logger(collector, std::chrono::hours(1));
+    logger.AddSink(sink);
+
+    std::vector<std::shared_ptr<metrics::Counter>> counters;
+    for (int i = 0; i < 4100; ++i) {
+        counters.push_back(std::make_shared<metrics::Counter>("overflow_" + std::to_string(i)));
+        logger.RegisterMetric(counters.back());
+        counters.back()->Increment();
+    }
+
+    logger.Flush();
+    assert(logger.DroppedSnapshots() == 4);
+    logger.Stop();
+    assert(sink->Buffers().size() == 1);
+    assert(logger.DroppedBatches() == 0);
+
+    std::cout << "Logger dropped snapshots tests passed!" << std::endl;
+}
+
+void TestGaugeConsistentSnapshots() {
+    std::cout << "Testing Gauge snapshots under concurrent Set..." << std::endl;
+
+    metrics::Gauge gauge("snapshot_gauge");
+    assert(!gauge.Read().has_value());
+    const uint64_t num_sets = 200000;
+
+    // Every Set stores its own sequence number, so a torn read would pair a value with a
+    // different update count.
+    std::thread writer([&gauge]() {
+        for (uint64_t i = 1; i <= num_sets; ++i) {
+            gauge.Set(static_cast<double>(i));
+        }
+    });
+
+    double last_reported = 0;
+    while (true) {
+        auto reading = gauge.Snapshot();
+        assert(reading.value == static_cast<double>(reading.updates));
+        if (gauge.HasValue()) {
+            double value = std::get<double>(gauge.GetAndReset());
+            assert(value >= last_reported);
+            last_reported = value;
+        }
+        if (reading.updates == num_sets) {
+            break;
+        }
+    }
+    writer.join();
+
+    // The final Set is never lost to a racing GetAndReset.
+    if (gauge.HasValue()) {
+        last_reported = std::get<double>(gauge.GetAndReset());
+    }
+    assert(last_reported == static_cast<double>(num_sets));
+    assert(std::get<double>(*gauge.Read()) == static_cast<double>(num_sets));
+
+    std::cout << "Gauge snapshot tests passed!" << std::endl;
+}
+
+// Custom metric written against the original interface, without Read.
+class DeltaOnlyMetric : public metrics::IMetric {
+public:
+    std::string GetName() const override {
+        return "delta_only";
+    }
+
+    metrics::MetricValue GetAndReset() override {
+        return int64_t{1};
+    }
+
+    bool HasValue() const override {
+        return true;
+    }
+};
+
+void TestCumulativeMode() {
+    std::cout << "Testing cumulative collection mode..." << std::endl;
+
+    auto counter = std::make_shared<metrics::Counter>("requests");
+    auto gauge = std::make_shared<metrics::Gauge>("CPU");
+    auto unset = std::make_shared<metrics::Gauge>("unset");
+    auto delta_only = std::make_shared<DeltaOnlyMetric>();
+    assert(!delta_only->Read().has_value());
+
+    metrics::SharedCollector collector;
+    std::vector<std::shared_ptr<RecordingSink>> sinks;
+    std::vector<std::unique_ptr<metrics::MetricsLogger>> loggers;
+    for (int i = 0; i < 2; ++i) {
+        sinks.push_back(std::make_shared<RecordingSink>(metrics::Format::kText));
+        loggers.push_back(std::make_unique<metrics::MetricsLogger>(collector, std::chrono::hours(1)));
+        loggers.back()->SetCollectionMode(metrics::CollectionMode::kCumulative);
+        loggers.back()->AddSink(sinks.back());
+        loggers.back()->RegisterMetric(counter);
+        loggers.back()->RegisterMetric(gauge);
+        loggers.back()->RegisterMetric(unset);
+        loggers.back()->RegisterMetric(delta_only);
+    }
+
+    counter->Increment(5);
+    gauge->Set(0.5);
+    for (auto& logger : loggers) {
+        logger->Flush();
+        logger->Flush();
+    }
+    counter->Increment(2);
+    for (auto& logger : loggers) {
+        logger->Stop();
+    }
+
+    // Both loggers see the full totals; nothing was reset by the other one.
+    for (const auto& sink : sinks) {
+        auto buffers = sink->Buffers();
+        assert(buffers.size() == 3);
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            assert(buffers[i]->find(i < 2 ? "\"requests\" 5" : "\"requests\" 7") != std::string::npos);
+            assert(buffers[i]->find("\"CPU\" 0.5") != std::string::npos);
+            assert(buffers[i]->find("unset") == std::string::npos);
+            assert(buffers[i]->find("delta_only") == std::string::npos);
+        }
+    }
+
+    // Delta consumers keep working alongside cumulative readers.
+    assert(std::get<int64_t>(counter->GetAndReset()) == 7);
+    assert(std::get<int64_t>(*counter->Read()) == 7);
+
+    std::cout << "Cumulative collection mode tests passed!" << std::endl;
+}
+
+void TestCounterCheckpoint() {
+    std::cout << "Testing Counter checkpoint..." << std::endl;
+
+    const std::string path = "test_counters.ckpt";
+    std::remove(path.c_str());
+
+    {
+        metrics::CounterCheckpoint checkpoint(path, 4);
+        assert(checkpoint.IsOpen());
+        auto requests = std::make_shared<metrics::Counter>("requests");
+        auto errors = std::make_shared<metrics::Counter>("errors");
+        assert(checkpoint.Attach(requests));
+        assert(checkpoint.Attach(errors));
+        assert(!checkpoint.Attach(std::make_shared<metrics::Counter>("requests")));
+        assert(!checkpoint.Attach(std::make_shared<metrics::Counter>(std::string(metrics::CounterCheckpoint::kMaxNameLength + 1, 'x'))));
+
+        requests->Increment(40);
+        checkpoint.Save();
+        requests->Increment(2);
+        errors->Increment(3);
+        // The destructor saves the latest totals.
+    }
+
+    {
+        metrics::CounterCheckpoint checkpoint(path, 1);
+        auto requests = std::make_shared<metrics::Counter>("requests");
+        assert(checkpoint.Attach(requests));
+        assert(requests->Total() == 42);
+        assert(!requests->HasValue());
+
+        requests->Increment();
+        assert(std::get<int64_t>(requests->GetAndReset()) == 1);
+        assert(std::get<int64_t>(*requests->Read()) == 43);
+
+        // The capacity of an existing file wins over the constructor argument.
+        assert(checkpoint.Attach(std::make_shared<metrics::Counter>("latency")));
+        assert(checkpoint.Attach(std::make_shared<metrics::Counter>("timeouts")));
+        assert(!checkpoint.Attach(std::make_shared<metrics::Counter>("overflow")));
+
+        auto errors = std::make_shared<metrics::Counter>("errors");
+        assert(checkpoint.Attach(errors));
+        assert(errors->Total() == 3);
+    }
+
+    {
+        // Totals reach the file without Save or destruction, as if the process then crashed.
+        metrics::CounterCheckpoint checkpoint(path, 4, std::chrono::milliseconds(10));
+        auto requests = std::make_shared<metrics::Counter>("requests");
+        assert(checkpoint.Attach(requests));
+        requests->Increment(100);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        metrics::CounterCheckpoint after_restart(path, 4, std::chrono::milliseconds(0));
+        auto restored = std::make_shared<metrics::Counter>("requests");
+        assert(after_restart.Attach(restored));
+        assert(restored->Total() == 143);
+    }
+
+    {
+        std::ofstream(path, std::ios::trunc) << "not a checkpoint file, just some text";
+        metrics::CounterCheckpoint checkpoint(path);
+        assert(!checkpoint.IsOpen());
+        assert(!checkpoint.Attach(std::make_shared<metrics::Counter>("requests")));
+    }
+
+    std::remove(path.c_str());
+
+    std::cout << "Counter checkpoint tests passed!" << std::endl;
+}
+
 void RunAllTests() {
     std::cout << "=== Running Tests ===" << std::endl;
 
@@ -465,12 +1412,39 @@ void RunAllTests() {
     TestCounterEdgeCases();
     TestGaugeEdgeCases();
     TestMultithreadedCounter();
+    TestGaugeConsistentSnapshots();
+    TestCumulativeMode();
+    TestCounterCheckpoint();
 
     TestLoggerBasic();
     TestLoggerStopStart();
     TestLoggerMultipleMetrics();
     TestEmptyMetricsLogger();
 
+    TestBinaryFormatRoundTrip();
+    TestUnixSocketSink();
+    TestUnixSocketSinkReconnect();
+
+    TestFanOutSharesBuffers();
+    TestFanOutSlowSink();
+    TestLoggerWithoutFile();
+    TestLoggerThreadCount();
+
+    TestSharedCollectorTasks();
+    TestSharedCollectorSlowSink();
+    TestSharedCollectorLoggers();
+    TestConcurrentFlush();
+    TestLoggerDroppedSnapshots();
+
+    TestCompressorRoundTrip();
+    TestFileSinkSizeRotation();
+    TestFileSinkPeriodRotation();
+    TestFileSinkSharedFile();
+
+    TestParseLine();
+    TestLogReaderQuery();
+    TestLogReaderNonMonotonic();
+
     std::cout << "=== All Tests Passed! ===" << std::endl << std::endl;
 }
 
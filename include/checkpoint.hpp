@@ -0,0 +1,235 @@
+#pragma once
+
+#include "metric.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace metrics {
+
+// Persists Counter totals in a memory-mapped file so a restarted process resumes them instead
+// of counting from zero. Attach restores the saved total; Save copies the current totals into
+// the mapping. A background thread calls Save every save_interval and the destructor once more,
+// so a crash loses at most the increments of the last save_interval. Saved totals reach the
+// page cache immediately and survive a process crash; they survive a power loss once the
+// kernel has written them back.
+//
+// File layout: a 64-byte header { "MCKPT1\0\0", u32 capacity } followed by capacity 64-byte
+// slots { NUL-terminated name[56], i64 total } in host byte order. A slot is free while its
+// name is empty.
+class CounterCheckpoint {
+public:
+    static constexpr size_t kMaxNameLength = 55;
+    static constexpr std::chrono::milliseconds kDefaultSaveInterval{100};
+
+    // A zero save_interval disables the background thread; totals are then saved only by Save
+    // and the destructor.
+    explicit CounterCheckpoint(const std::string& path, uint32_t capacity = 1024, std::chrono::milliseconds save_interval = kDefaultSaveInterval)
+        : save_interval_(save_interval) {
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            return;
+        }
+        if (!Map(capacity)) {
+            Unmap();
+            return;
+        }
+        if (save_interval_.count() > 0) {
+            saver_ = std::thread(&CounterCheckpoint::SaveLoop, this);
+        }
+    }
+
+    CounterCheckpoint(const CounterCheckpoint&) = delete;
+    CounterCheckpoint& operator=(const CounterCheckpoint&) = delete;
+
+    ~CounterCheckpoint() noexcept {
+        if (saver_.joinable()) {
+            {
+                std::lock_guard lock(saver_mutex_);
+                stopping_ = true;
+            }
+            saver_cv_.notify_one();
+            saver_.join();
+        }
+        Save();
+        Unmap();
+    }
+
+    bool IsOpen() const {
+        return slots_ != nullptr;
+    }
+
+    // Adds the checkpointed total of the counter's name (if any) to the counter and saves it
+    // from now on. Attach before registering the counter with a logger so the restored total
+    // is not reported as a delta. Returns false if the name is too long, already attached or
+    // the file has no free slot.
+    bool Attach(std::shared_ptr<Counter> counter) {
+        std::string name = counter->GetName();
+        if (name.empty() || name.size() > kMaxNameLength) {
+            return false;
+        }
+
+        std::lock_guard lock(mutex_);
+        if (!IsOpen() || std::ranges::any_of(attached_, [&](const auto& entry) { return entry.first->GetName() == name; })) {
+            return false;
+        }
+
+        Slot* slot = FindSlot(name);
+        if (slot) {
+            counter->Restore(std::atomic_ref(slot->total).load(std::memory_order_relaxed));
+        } else {
+            slot = FreeSlot();
+            if (!slot) {
+                return false;
+            }
+            // The total is written before the name so a crash never leaves a named slot with
+            // a stale total.
+            std::atomic_ref(slot->total).store(counter->Total(), std::memory_order_relaxed);
+            std::memcpy(slot->name, name.data(), name.size());
+        }
+        attached_.emplace_back(std::move(counter), slot);
+        return true;
+    }
+
+    void Save() noexcept {
+        std::lock_guard lock(mutex_);
+        for (const auto& [counter, slot] : attached_) {
+            std::atomic_ref(slot->total).store(counter->Total(), std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static constexpr std::string_view kMagic{"MCKPT1\0\0", 8};
+
+    struct Header {
+        char magic[8];
+        uint32_t capacity;
+        char reserved[52];
+    };
+
+    struct Slot {
+        char name[kMaxNameLength + 1];
+        alignas(8) int64_t total;
+    };
+
+    static_assert(sizeof(Header) == 64 && sizeof(Slot) == 64);
+
+    void SaveLoop() noexcept {
+        std::unique_lock lock(saver_mutex_);
+        while (!saver_cv_.wait_for(lock, save_interval_, [this] { return stopping_; })) {
+            Save();
+        }
+    }
+
+    static size_t FileSize(uint32_t capacity) {
+        return sizeof(Header) + size_t{capacity} * sizeof(Slot);
+    }
+
+    bool Map(uint32_t capacity) {
+        struct stat st {};
+        if (fstat(fd_, &st) != 0) {
+            return false;
+        }
+
+        Header header{};
+        auto size = static_cast<size_t>(st.st_size);
+        auto header_bytes = std::min(size, sizeof(Header));
+        if (pread(fd_, &header, header_bytes, 0) != static_cast<ssize_t>(header_bytes)) {
+            return false;
+        }
+
+        // A zero-filled header was never fully initialized (e.g. a crash right after the file
+        // was created) and is started afresh; anything else without the magic is not ours.
+        bool initialized = std::string_view(header.magic, sizeof(header.magic)) == kMagic;
+        auto* raw = reinterpret_cast<const char*>(&header);
+        if (!initialized && std::any_of(raw, raw + sizeof(header), [](char c) { return c != '\0'; })) {
+            return false;
+        }
+        if (initialized) {
+            capacity = header.capacity;
+            if (size < FileSize(capacity)) {
+                return false;
+            }
+        } else if (capacity == 0 || ftruncate(fd_, static_cast<off_t>(FileSize(capacity))) != 0) {
+            return false;
+        }
+
+        mapping_size_ = FileSize(capacity);
+        void* mapping = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        mapping_ = mapping;
+
+        auto* mapped_header = static_cast<Header*>(mapping_);
+        if (!initialized) {
+            mapped_header->capacity = capacity;
+            std::memcpy(mapped_header->magic, kMagic.data(), kMagic.size());
+        }
+        slots_ = reinterpret_cast<Slot*>(static_cast<char*>(mapping_) + sizeof(Header));
+        capacity_ = capacity;
+        return true;
+    }
+
+    void Unmap() noexcept {
+        if (mapping_) {
+            munmap(mapping_, mapping_size_);
+            mapping_ = nullptr;
+        }
+        slots_ = nullptr;
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    Slot* FindSlot(const std::string& name) {
+        for (uint32_t i = 0; i < capacity_; ++i) {
+            if (std::strncmp(slots_[i].name, name.c_str(), sizeof(Slot::name)) == 0) {
+                return &slots_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    Slot* FreeSlot() {
+        for (uint32_t i = 0; i < capacity_; ++i) {
+            if (slots_[i].name[0] == '\0') {
+                return &slots_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    int fd_ = -1;
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    Slot* slots_ = nullptr;
+    uint32_t capacity_ = 0;
+    std::mutex mutex_;
+    std::vector<std::pair<std::shared_ptr<Counter>, Slot*>> attached_;
+
+    const std::chrono::milliseconds save_interval_;
+    std::mutex saver_mutex_;
+    std::condition_variable saver_cv_;
+    bool stopping_ = false;
+    std::thread saver_;
+};
+
+}  // namespace metrics
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "format.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace metrics {
+
+// Self-contained LZ77 compressor for closed log segments (LZ4-style sequences).
+// A sequence is a token (literal length << 4 | (match length - 4)), extra length bytes for
+// either nibble equal to 15, the literals and a u16 match offset; the last sequence of a
+// block has literals only.
+//
+// File layout: "MLZ1", then blocks of { u32 raw size, u32 compressed size, compressed bytes }.
+
+inline constexpr std::string_view kCompressedMagic = "MLZ1";
+inline constexpr std::string_view kCompressedExtension = ".mlz";
+
+namespace detail {
+
+inline constexpr size_t kMinMatch = 4;
+inline constexpr size_t kHashBits = 16;
+inline constexpr size_t kMaxOffset = 65535;
+inline constexpr size_t kCompressionBlockSize = 1 << 20;
+
+inline uint32_t Read32(const char* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+inline uint32_t HashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+inline void PutLength(std::string& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+// Fails once length would exceed limit, so corrupt input cannot run up huge lengths.
+inline bool GetLength(std::string_view& in, size_t& length, size_t limit) {
+    while (true) {
+        if (in.empty()) {
+            return false;
+        }
+        auto byte = static_cast<uint8_t>(in[0]);
+        in.remove_prefix(1);
+        length += byte;
+        if (length > limit) {
+            return false;
+        }
+        if (byte != 255) {
+            return true;
+        }
+    }
+}
+
+inline void PutSequence(std::string& out, std::string_view literals, size_t offset, size_t match_length) {
+    size_t match_code = match_length == 0 ? 0 : match_length - kMinMatch;
+    auto token = static_cast<uint8_t>((std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(match_code, 15));
+    out.push_back(static_cast<char>(token));
+    if (literals.size() >= 15) {
+        PutLength(out, literals.size() - 15);
+    }
+    out.append(literals);
+    if (match_length == 0) {
+        return;
+    }
+    PutLittleEndian<uint16_t>(out, static_cast<uint16_t>(offset));
+    if (match_code >= 15) {
+        PutLength(out, match_code - 15);
+    }
+}
+
+}  // namespace detail
+
+inline std::string CompressBlock(std::string_view input) {
+    std::string out;
+    out.reserve(input.size() / 2 + 16);
+    std::vector<int64_t> table(size_t{1} << detail::kHashBits, -1);
+
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + detail::kMinMatch <= input.size()) {
+        uint32_t sequence = detail::Read32(input.data() + pos);
+        auto& slot = table[detail::HashSequence(sequence)];
+        int64_t candidate = slot;
+        slot = static_cast<int64_t>(pos);
+
+        if (candidate < 0 || pos - static_cast<size_t>(candidate) > detail::kMaxOffset || detail::Read32(input.data() + candidate) != sequence) {
+            ++pos;
+            continue;
+        }
+
+        auto match = static_cast<size_t>(candidate);
+        size_t length = detail::kMinMatch;
+        while (pos + length < input.size() && input[match + length] == input[pos + length]) {
+            ++length;
+        }
+
+        detail::PutSequence(out, input.substr(anchor, pos - anchor), pos - match, length);
+        pos += length;
+        anchor = pos;
+    }
+
+    detail::PutSequence(out, input.substr(anchor), 0, 0);
+    return out;
+}
+
+// Never writes more than raw_size bytes: corrupt input fails as soon as a sequence would
+// run past it.
+inline bool DecompressBlock(std::string_view input, size_t raw_size, std::string& out) {
+    size_t block_start = out.size();
+    out.reserve(block_start + raw_size);
+    while (!input.empty()) {
+        auto token = static_cast<uint8_t>(input[0]);
+        input.remove_prefix(1);
+
+        size_t remaining = raw_size - (out.size() - block_start);
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !detail::GetLength(input, literal_length, remaining)) {
+            return false;
+        }
+        if (input.size() < literal_length || literal_length > remaining) {
+            return false;
+        }
+        out.append(input.substr(0, literal_length));
+        input.remove_prefix(literal_length);
+        if (input.empty()) {
+            break;
+        }
+
+        uint16_t offset = 0;
+        if (!detail::GetLittleEndian(input, offset)) {
+            return false;
+        }
+        remaining -= literal_length;
+        size_t match_length = token & 0x0f;
+        if (match_length == 15 && !detail::GetLength(input, match_length, remaining)) {
+            return false;
+        }
+        match_length += detail::kMinMatch;
+        if (match_length > remaining) {
+            return false;
+        }
+
+        if (offset == 0 || offset > out.size() - block_start) {
+            return false;
+        }
+        size_t from = out.size() - offset;
+        for (size_t i = 0; i < match_length; ++i) {
+            out.push_back(out[from + i]);
+        }
+    }
+    return out.size() - block_start == raw_size;
+}
+
+// Gives up between two blocks once cancel is set.
+inline bool CompressFile(const std::string& source, const std::string& destination, const std::atomic_bool* cancel = nullptr) {
+    std::ifstream in(source, std::ios::binary);
+    std::ofstream out(destination, std::ios::binary | std::ios::trunc);
+    if (!in.is_open() || !out.is_open()) {
+        return false;
+    }
+
+    out.write(kCompressedMagic.data(), static_cast<std::streamsize>(kCompressedMagic.size()));
+    std::string block(detail::kCompressionBlockSize, '\0');
+    while (in) {
+        if (cancel && cancel->load()) {
+            return false;
+        }
+        in.read(block.data(), static_cast<std::streamsize>(block.size()));
+        auto raw_size = static_cast<size_t>(in.gcount());
+        if (raw_size == 0) {
+            break;
+        }
+
+        std::string compressed = CompressBlock(std::string_view(block.data(), raw_size));
+        std::string header;
+        detail::PutLittleEndian<uint32_t>(header, static_cast<uint32_t>(raw_size));
+        detail::PutLittleEndian<uint32_t>(header, static_cast<uint32_t>(compressed.size()));
+        out << header << compressed;
+    }
+    out.flush();
+    return !in.bad() && out.good();
+}
+
+inline bool DecompressFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::string_view input(data);
+    if (!input.starts_with(kCompressedMagic)) {
+        return false;
+    }
+    input.remove_prefix(kCompressedMagic.size());
+
+    out.clear();
+    while (!input.empty()) {
+        uint32_t raw_size = 0;
+        uint32_t compressed_size = 0;
+        // CompressFile never writes blocks larger than kCompressionBlockSize; anything bigger is corrupt.
+        if (!detail::GetLittleEndian(input, raw_size) || !detail::GetLittleEndian(input, compressed_size) || input.size() < compressed_size ||
+            raw_size > detail::kCompressionBlockSize) {
+            return false;
+        }
+        if (!DecompressBlock(input.substr(0, compressed_size), raw_size, out)) {
+            return false;
+        }
+        input.remove_prefix(compressed_size);
+    }
+    return true;
+}
+
+}  // namespace metrics
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "sink.hpp"
+#include "shared_collector.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace metrics {
+
+enum class BackpressurePolicy {
+    kDropOldest,
+    kDropNewest,
+};
+
+struct SinkOptions {
+    size_t max_pending = 64;
+    BackpressurePolicy policy = BackpressurePolicy::kDropOldest;
+    // Only meaningful for loggers attached to a SharedCollector: deliver on a private thread
+    // instead of the collector's shared delivery thread. Use it for sinks that may block for
+    // long, so they do not hold up the other sinks.
+    bool dedicated_thread = false;
+};
+
+// Delivers buffers to one sink, either on its own thread or as drain tasks posted to a
+// SharedCollector. Push never blocks on the sink: once max_pending buffers are queued
+// the backpressure policy decides what is dropped.
+//
+// An inline worker instead writes to the sink on the thread calling Push, with no queue and
+// no backpressure, until StartThread moves it onto a thread of its own.
+class SinkWorker {
+public:
+    SinkWorker(std::shared_ptr<ISink> sink, SinkOptions options, SharedCollector* executor = nullptr, bool inline_delivery = false)
+        : sink_(std::move(sink)), format_(sink_->GetFormat()), options_(options), executor_(options.dedicated_thread ? nullptr : executor) {
+        if (!executor_ && (options_.dedicated_thread || !inline_delivery)) {
+            thread_ = std::thread(&SinkWorker::Loop, this);
+        }
+    }
+
+    SinkWorker(const SinkWorker&) = delete;
+    SinkWorker& operator=(const SinkWorker&) = delete;
+
+    ~SinkWorker() noexcept {
+        Stop();
+    }
+
+    Format GetFormat() const {
+        return format_;
+    }
+
+    // Push calls on an inline worker must not overlap; FanOut serializes them.
+    void Push(SharedBuffer buffer) {
+        std::unique_lock lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        if (!executor_ && !thread_.joinable()) {
+            lock.unlock();
+            Write(buffer);
+            return;
+        }
+
+        if (pending_.size() >= options_.max_pending) {
+            ++dropped_;
+            if (options_.policy == BackpressurePolicy::kDropNewest) {
+                return;
+            }
+            pending_.pop_front();
+        }
+        pending_.push_back(std::move(buffer));
+        if (executor_) {
+            if (drain_scheduled_) {
+                return;
+            }
+            drain_scheduled_ = true;
+        }
+        lock.unlock();
+
+        if (executor_) {
+            executor_->Post([this] { Drain(); });
+        } else {
+            cv_.notify_one();
+        }
+    }
+
+    // Moves an inline worker onto its own thread; a no-op for other workers.
+    void StartThread() {
+        std::lock_guard lock(mutex_);
+        if (!executor_ && !stopping_ && !thread_.joinable()) {
+            thread_ = std::thread(&SinkWorker::Loop, this);
+        }
+    }
+
+    // Delivers everything already queued, then joins the worker thread or waits for the pending drain task.
+    void Stop() noexcept {
+        std::unique_lock lock(mutex_);
+        stopping_ = true;
+        if (executor_) {
+            cv_.wait(lock, [this] { return !drain_scheduled_; });
+            return;
+        }
+        if (!thread_.joinable()) {
+            return;
+        }
+        lock.unlock();
+        cv_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    uint64_t Dropped() const {
+        return dropped_.load();
+    }
+
+private:
+    void Loop() noexcept {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                return;
+            }
+
+            SharedBuffer buffer = std::move(pending_.front());
+            pending_.pop_front();
+            lock.unlock();
+            Write(buffer);
+            lock.lock();
+        }
+    }
+
+    void Write(const SharedBuffer& buffer) noexcept {
+        try {
+            sink_->Write(buffer);
+        } catch (...) {
+        }
+    }
+
+    void Drain() noexcept {
+        std::unique_lock lock(mutex_);
+        while (!pending_.empty()) {
+            SharedBuffer buffer = std::move(pending_.front());
+            pending_.pop_front();
+            lock.unlock();
+            Write(buffer);
+            lock.lock();
+        }
+        drain_scheduled_ = false;
+        cv_.notify_all();
+    }
+
+    const std::shared_ptr<ISink> sink_;
+    const Format format_;
+    const SinkOptions options_;
+    SharedCollector* const executor_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<SharedBuffer> pending_;
+    bool stopping_ = false;
+    bool drain_scheduled_ = false;
+    std::atomic_uint64_t dropped_{0};
+    std::thread thread_;
+};
+
+// Formats each batch once per format in use and hands the same immutable buffer to every sink of that format.
+// Without a SharedCollector, a lone sink is written inline on the publishing thread, so a logger with one
+// file costs one thread; every sink gets a worker thread as soon as there are two.
+class FanOut {
+public:
+    explicit FanOut(SharedCollector* executor = nullptr) : executor_(executor) {
+    }
+
+    void AddSink(std::shared_ptr<ISink> sink, SinkOptions options = {}) {
+        std::lock_guard lock(mutex_);
+        for (const auto& worker : workers_) {
+            worker->StartThread();
+        }
+        workers_.push_back(std::make_unique<SinkWorker>(std::move(sink), options, executor_, workers_.empty()));
+    }
+
+    void Publish(std::span<const MetricSnapshot> batch) {
+        if (batch.empty()) {
+            return;
+        }
+
+        std::array<SharedBuffer, kFormatCount> formatted;
+        std::lock_guard lock(mutex_);
+        for (const auto& worker : workers_) {
+            auto& buffer = formatted[static_cast<size_t>(worker->GetFormat())];
+            if (!buffer) {
+                buffer = FormatBatch(worker->GetFormat(), batch);
+            }
+            worker->Push(buffer);
+        }
+    }
+
+    void Stop() noexcept {
+        std::lock_guard lock(mutex_);
+        for (const auto& worker : workers_) {
+            worker->Stop();
+        }
+    }
+
+    uint64_t Dropped() const {
+        std::lock_guard lock(mutex_);
+        uint64_t dropped = 0;
+        for (const auto& worker : workers_) {
+            dropped += worker->Dropped();
+        }
+        return dropped;
+    }
+
+private:
+    SharedCollector* const executor_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<SinkWorker>> workers_;
+};
+
+}  // namespace metrics
@@ -0,0 +1,344 @@
+#pragma once
+
+#include "compressor.hpp"
+#include "sink.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace metrics {
+
+struct RotationOptions {
+    // Start a new segment before a write would grow the current one past max_bytes (0 disables).
+    size_t max_bytes = 0;
+    // Start a new segment at every multiple of period since the epoch (0 disables).
+    std::chrono::seconds period{0};
+    // Space reserved for every new segment; 0 reserves min(max_bytes, 64 MiB), or 64 MiB
+    // with period-only rotation.
+    size_t preallocate_bytes = 0;
+    // Compress closed segments to <segment>.mlz on a background thread.
+    bool compress = false;
+};
+
+// Compresses closed segments one at a time on a thread running at idle priority.
+// Shutting down does not wait for the backlog: queued segments and the one in progress
+// (abandoned at the next block boundary) stay uncompressed on disk, and FileSink queues
+// them again when it is next opened.
+class SegmentCompressor {
+public:
+    SegmentCompressor() : thread_(&SegmentCompressor::Loop, this) {
+    }
+
+    SegmentCompressor(const SegmentCompressor&) = delete;
+    SegmentCompressor& operator=(const SegmentCompressor&) = delete;
+
+    ~SegmentCompressor() noexcept {
+        {
+            std::lock_guard lock(mutex_);
+            stopping_ = true;
+            pending_.clear();
+        }
+        cv_.notify_one();
+        thread_.join();
+    }
+
+    void Enqueue(std::string path) {
+        {
+            std::lock_guard lock(mutex_);
+            pending_.push_back(std::move(path));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    static void LowerPriority() noexcept {
+        sched_param param{};
+        if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) != 0) {
+            setpriority(PRIO_PROCESS, static_cast<id_t>(gettid()), 19);
+        }
+    }
+
+    void Compress(const std::string& path) noexcept {
+        try {
+            std::string destination = path + std::string(kCompressedExtension);
+            std::string temporary = destination + ".tmp";
+            if (CompressFile(path, temporary, &stopping_) && std::rename(temporary.c_str(), destination.c_str()) == 0) {
+                std::remove(path.c_str());
+            } else {
+                std::remove(temporary.c_str());
+            }
+        } catch (...) {
+        }
+    }
+
+    void Loop() noexcept {
+        LowerPriority();
+
+        std::unique_lock lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (stopping_) {
+                return;
+            }
+
+            std::string path = std::move(pending_.front());
+            pending_.pop_front();
+            lock.unlock();
+            Compress(path);
+            lock.lock();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::string> pending_;
+    std::atomic_bool stopping_{false};
+    std::thread thread_;
+};
+
+// Appends text batches to a file, optionally rotating it by size and/or wall-clock period.
+//
+// The next segment is created and preallocated ahead of time as <filename>.next. Rotation
+// happens between two writes: the current file gets a hard link under its archive name
+// (<filename>.<YYYYmmdd-HHMMSS>-<NNN>) and <filename>.next is renamed over <filename>, so
+// the active path always names a complete file and no data is copied.
+class FileSink : public ISink {
+public:
+    explicit FileSink(std::string filename, RotationOptions rotation = {})
+        : filename_(std::move(filename)), next_filename_(filename_ + ".next"), rotation_(rotation) {
+        if (rotation_.preallocate_bytes == 0) {
+            rotation_.preallocate_bytes = rotation_.max_bytes > 0 ? std::min<size_t>(rotation_.max_bytes, kMaxDefaultPreallocation) : kMaxDefaultPreallocation;
+        }
+
+        fd_ = OpenSegment(filename_);
+        struct stat st {};
+        if (fd_ >= 0 && fstat(fd_, &st) == 0) {
+            size_ = static_cast<size_t>(st.st_size);
+        }
+        if (RotationEnabled()) {
+            segment_deadline_ = NextDeadline();
+            PrepareNextSegment();
+        }
+        if (rotation_.compress) {
+            CompressLeftoverArchives();
+        }
+    }
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    ~FileSink() noexcept override {
+        CloseSegment(fd_, preallocated_);
+        if (next_fd_ >= 0) {
+            close(next_fd_);
+            unlink(next_filename_.c_str());
+        }
+    }
+
+    Format GetFormat() const override {
+        return Format::kText;
+    }
+
+    void Write(const SharedBuffer& buffer) override {
+        if (fd_ < 0) {
+            return;
+        }
+        if (ShouldRotate(buffer->size())) {
+            Rotate();
+        }
+
+        const char* data = buffer->data();
+        size_t remaining = buffer->size();
+        while (remaining > 0) {
+            ssize_t written = write(fd_, data, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            data += written;
+            remaining -= static_cast<size_t>(written);
+            size_ += static_cast<size_t>(written);
+        }
+
+        if (RotationEnabled() && next_fd_ < 0) {
+            PrepareNextSegment();
+        }
+    }
+
+    bool IsOpen() const {
+        return fd_ >= 0;
+    }
+
+private:
+    static constexpr size_t kMaxDefaultPreallocation = 64 << 20;
+
+    bool RotationEnabled() const {
+        return rotation_.max_bytes > 0 || rotation_.period.count() > 0;
+    }
+
+    bool ShouldRotate(size_t incoming) const {
+        if (!RotationEnabled() || size_ == 0) {
+            return false;
+        }
+        if (rotation_.max_bytes > 0 && size_ + incoming > rotation_.max_bytes) {
+            return true;
+        }
+        return rotation_.period.count() > 0 && std::chrono::system_clock::now() >= segment_deadline_;
+    }
+
+    std::chrono::system_clock::time_point NextDeadline() const {
+        if (rotation_.period.count() == 0) {
+            return std::chrono::system_clock::time_point::max();
+        }
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        auto periods = now / rotation_.period;
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(rotation_.period * (periods + 1)));
+    }
+
+    static int OpenSegment(const std::string& path) {
+        return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    }
+
+    void PrepareNextSegment() {
+        next_fd_ = open(next_filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (next_fd_ >= 0 && rotation_.preallocate_bytes > 0) {
+            // KEEP_SIZE reserves the blocks without exposing zero padding to readers.
+            fallocate(next_fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(rotation_.preallocate_bytes));
+        }
+    }
+
+    // Returns blocks that PrepareNextSegment reserved past the end of the file. Truncating
+    // to the current length leaves the data alone even if other processes append to or
+    // truncate the file; files this sink did not preallocate are never truncated.
+    static void CloseSegment(int fd, bool preallocated) {
+        if (fd < 0) {
+            return;
+        }
+        struct stat st {};
+        if (preallocated && fstat(fd, &st) == 0) {
+            ftruncate(fd, st.st_size);
+        }
+        close(fd);
+    }
+
+    std::string ArchiveName() const {
+        auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::tm tm{};
+        localtime_r(&now, &tm);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+
+        for (size_t sequence = 0;; ++sequence) {
+            char suffix[16];
+            std::snprintf(suffix, sizeof(suffix), "-%03zu", sequence);
+            std::string name = filename_ + "." + stamp + suffix;
+            std::error_code ec;
+            if (!std::filesystem::exists(name, ec) && !std::filesystem::exists(name + std::string(kCompressedExtension), ec)) {
+                return name;
+            }
+        }
+    }
+
+    // Matches the <YYYYmmdd-HHMMSS>-<NNN> suffix produced by ArchiveName.
+    static bool IsArchiveSuffix(std::string_view suffix) {
+        auto digits = [](std::string_view part) { return !part.empty() && std::ranges::all_of(part, [](char c) { return c >= '0' && c <= '9'; }); };
+        return suffix.size() >= 19 && digits(suffix.substr(0, 8)) && suffix[8] == '-' && digits(suffix.substr(9, 6)) && suffix[15] == '-' && digits(suffix.substr(16));
+    }
+
+    // Queues archives a previous run closed but did not get to compress.
+    void CompressLeftoverArchives() {
+        std::filesystem::path path(filename_);
+        std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+        std::string prefix = path.filename().string() + ".";
+
+        std::vector<std::string> leftovers;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+            std::string name = entry.path().filename().string();
+            if (name.starts_with(prefix) && IsArchiveSuffix(std::string_view(name).substr(prefix.size()))) {
+                leftovers.push_back(entry.path().string());
+            }
+        }
+        if (leftovers.empty()) {
+            return;
+        }
+
+        std::sort(leftovers.begin(), leftovers.end());
+        compressor_ = std::make_unique<SegmentCompressor>();
+        for (auto& leftover : leftovers) {
+            compressor_->Enqueue(std::move(leftover));
+        }
+    }
+
+    void Rotate() {
+        if (next_fd_ < 0) {
+            PrepareNextSegment();
+            if (next_fd_ < 0) {
+                return;
+            }
+        }
+
+        std::string archive = ArchiveName();
+        if (link(filename_.c_str(), archive.c_str()) == 0) {
+            if (rename(next_filename_.c_str(), filename_.c_str()) != 0) {
+                unlink(archive.c_str());
+                return;
+            }
+        } else if (rename(filename_.c_str(), archive.c_str()) != 0) {
+            return;
+        } else if (rename(next_filename_.c_str(), filename_.c_str()) != 0) {
+            // Without hard links the active path briefly disappears between the two renames;
+            // put the current segment back so later rotations can still find it.
+            rename(archive.c_str(), filename_.c_str());
+            return;
+        }
+
+        CloseSegment(fd_, preallocated_);
+        fd_ = next_fd_;
+        preallocated_ = rotation_.preallocate_bytes > 0;
+        next_fd_ = -1;
+        size_ = 0;
+        segment_deadline_ = NextDeadline();
+
+        if (rotation_.compress) {
+            if (!compressor_) {
+                compressor_ = std::make_unique<SegmentCompressor>();
+            }
+            compressor_->Enqueue(std::move(archive));
+        }
+    }
+
+    const std::string filename_;
+    const std::string next_filename_;
+    RotationOptions rotation_;
+    int fd_ = -1;
+    int next_fd_ = -1;
+    // Whether fd_ came from PrepareNextSegment and may have blocks reserved past its end.
+    bool preallocated_ = false;
+    size_t size_ = 0;
+    std::chrono::system_clock::time_point segment_deadline_ = std::chrono::system_clock::time_point::max();
+    std::unique_ptr<SegmentCompressor> compressor_;
+};
+
+}  // namespace metrics
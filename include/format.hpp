@@ -0,0 +1,187 @@
+#pragma once
+
+#include "metric.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace metrics {
+
+enum class Format { kText, kBinary };
+
+inline constexpr size_t kFormatCount = 2;
+
+// Formatted batches are immutable once built and shared by every sink using the same format.
+using SharedBuffer = std::shared_ptr<const std::string>;
+
+inline std::string FormatTimestamp(const std::chrono::system_clock::time_point& tp) {
+    auto time_t = std::chrono::system_clock::to_time_t(tp);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()) % 1000;
+
+    std::tm tm{};
+    localtime_r(&time_t, &tm);
+
+    std::stringstream ss;
+    ss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+    ss << "." << std::setfill('0') << std::setw(3) << ms.count();
+    return ss.str();
+}
+
+inline void WriteTextLine(std::ostream& out, std::span<const MetricSnapshot> batch) {
+    if (batch.empty()) {
+        return;
+    }
+
+    out << FormatTimestamp(batch[0].timestamp);
+    for (const auto& snap : batch) {
+        out << " \"" << snap.name << "\" ";
+        std::visit([&out](const auto& value) { out << value; }, snap.value);
+    }
+    out << "\n";
+}
+
+// Binary batch layout (all integers little-endian):
+//   u8 version, i64 timestamp (ns since epoch), u32 count,
+//   count x { u16 name length, name bytes, u8 type (0 = int64, 1 = double), 8 value bytes }
+// On the wire every batch is preceded by a u32 payload length.
+inline constexpr uint8_t kBinaryFormatVersion = 1;
+inline constexpr size_t kFrameHeaderSize = 4;
+
+using FrameHeader = std::array<char, kFrameHeaderSize>;
+
+namespace detail {
+
+template <class T>
+void PutLittleEndian(std::string& out, T value) {
+    auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<char>((bits >> (8 * i)) & 0xff));
+    }
+}
+
+template <class T>
+bool GetLittleEndian(std::string_view& in, T& value) {
+    if (in.size() < sizeof(T)) {
+        return false;
+    }
+    std::make_unsigned_t<T> bits = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        bits |= static_cast<std::make_unsigned_t<T>>(static_cast<uint8_t>(in[i])) << (8 * i);
+    }
+    value = static_cast<T>(bits);
+    in.remove_prefix(sizeof(T));
+    return true;
+}
+
+}  // namespace detail
+
+inline std::string EncodeBinary(std::span<const MetricSnapshot> batch) {
+    std::string out;
+    out.reserve(16 + batch.size() * 32);
+
+    auto timestamp = batch.empty() ? std::chrono::system_clock::time_point{} : batch[0].timestamp;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count();
+
+    detail::PutLittleEndian<uint8_t>(out, kBinaryFormatVersion);
+    detail::PutLittleEndian<int64_t>(out, ns);
+    detail::PutLittleEndian<uint32_t>(out, static_cast<uint32_t>(batch.size()));
+
+    for (const auto& snap : batch) {
+        auto name_size = static_cast<uint16_t>(std::min<size_t>(snap.name.size(), UINT16_MAX));
+        detail::PutLittleEndian<uint16_t>(out, name_size);
+        out.append(snap.name.data(), name_size);
+
+        if (const auto* integer = std::get_if<int64_t>(&snap.value)) {
+            detail::PutLittleEndian<uint8_t>(out, 0);
+            detail::PutLittleEndian<int64_t>(out, *integer);
+        } else {
+            detail::PutLittleEndian<uint8_t>(out, 1);
+            detail::PutLittleEndian<uint64_t>(out, std::bit_cast<uint64_t>(std::get<double>(snap.value)));
+        }
+    }
+    return out;
+}
+
+inline bool DecodeBinary(std::string_view payload, std::vector<MetricSnapshot>& batch) {
+    uint8_t version = 0;
+    int64_t ns = 0;
+    uint32_t count = 0;
+    if (!detail::GetLittleEndian(payload, version) || version != kBinaryFormatVersion) {
+        return false;
+    }
+    if (!detail::GetLittleEndian(payload, ns) || !detail::GetLittleEndian(payload, count)) {
+        return false;
+    }
+
+    std::chrono::system_clock::time_point timestamp{std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns))};
+
+    batch.clear();
+    for (uint32_t i = 0; i < count; ++i) {
+        uint16_t name_size = 0;
+        if (!detail::GetLittleEndian(payload, name_size) || payload.size() < name_size) {
+            return false;
+        }
+        MetricSnapshot snap;
+        snap.name.assign(payload.data(), name_size);
+        snap.timestamp = timestamp;
+        payload.remove_prefix(name_size);
+
+        uint8_t type = 0;
+        uint64_t bits = 0;
+        if (!detail::GetLittleEndian(payload, type) || !detail::GetLittleEndian(payload, bits)) {
+            return false;
+        }
+        if (type == 0) {
+            snap.value = static_cast<int64_t>(bits);
+        } else if (type == 1) {
+            snap.value = std::bit_cast<double>(bits);
+        } else {
+            return false;
+        }
+        batch.push_back(std::move(snap));
+    }
+    return payload.empty();
+}
+
+inline FrameHeader EncodeFrameHeader(uint32_t payload_size) {
+    FrameHeader header;
+    for (size_t i = 0; i < kFrameHeaderSize; ++i) {
+        header[i] = static_cast<char>((payload_size >> (8 * i)) & 0xff);
+    }
+    return header;
+}
+
+inline uint32_t DecodeFrameHeader(const FrameHeader& header) {
+    uint32_t payload_size = 0;
+    for (size_t i = 0; i < kFrameHeaderSize; ++i) {
+        payload_size |= static_cast<uint32_t>(static_cast<uint8_t>(header[i])) << (8 * i);
+    }
+    return payload_size;
+}
+
+inline SharedBuffer FormatBatch(Format format, std::span<const MetricSnapshot> batch) {
+    if (format == Format::kBinary) {
+        return std::make_shared<const std::string>(EncodeBinary(batch));
+    }
+
+    std::ostringstream out;
+    WriteTextLine(out, batch);
+    return std::make_shared<const std::string>(std::move(out).str());
+}
+
+}  // namespace metrics
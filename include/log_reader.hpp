@@ -0,0 +1,410 @@
+#pragma once
+
+#include "compressor.hpp"
+#include "format.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace metrics {
+
+// Every line of a log starts with "YYYY-mm-dd HH:MM:SS.mmm", which sorts lexicographically in
+// time order, so time bounds are compared as strings of that form. Bounds may be truncated
+// ("2026-10-18 14:05") and ranges are half-open: [from, to). FormatTimestamp turns a
+// time_point into a bound.
+//
+// Index lookups assume timestamps never decrease within a file. FormatTimestamp writes local
+// time without a UTC offset, so the hour repeated when DST ends or a clock stepped backwards
+// breaks that. A segment whose index entries are out of order is scanned linearly in full;
+// disorder shorter than one index stride goes unnoticed, so range queries over local-time
+// logs are only exact when their timestamps are monotonic.
+inline constexpr size_t kTimestampSize = 23;
+inline constexpr size_t kDefaultIndexStride = 64 << 10;
+
+struct MetricRecord {
+    std::string_view timestamp;
+    std::string_view name;
+    std::string_view value;
+};
+
+struct IndexEntry {
+    uint64_t offset;
+    std::array<char, kTimestampSize> timestamp;
+
+    std::string_view Timestamp() const {
+        return {timestamp.data(), timestamp.size()};
+    }
+};
+
+inline bool HasTimestamp(std::string_view line) {
+    return line.size() >= kTimestampSize && line[4] == '-' && line[10] == ' ' && line[19] == '.';
+}
+
+// Calls callback for every ` "name" value` pair of a log line.
+template <class Callback>
+void ParseLine(std::string_view line, Callback&& callback) {
+    if (!HasTimestamp(line)) {
+        return;
+    }
+    std::string_view timestamp = line.substr(0, kTimestampSize);
+    std::string_view rest = line.substr(kTimestampSize);
+
+    while (rest.size() >= 2 && rest[0] == ' ' && rest[1] == '"') {
+        size_t name_end = rest.find('"', 2);
+        if (name_end == std::string_view::npos || name_end + 1 >= rest.size()) {
+            return;
+        }
+        std::string_view name = rest.substr(2, name_end - 2);
+        rest.remove_prefix(name_end + 2);
+
+        size_t value_end = std::min(rest.find(' '), rest.size());
+        callback(MetricRecord{timestamp, name, rest.substr(0, value_end)});
+        rest.remove_prefix(value_end);
+    }
+}
+
+// One log file, memory-mapped (compressed *.mlz segments are inflated into memory instead),
+// with a sparse index holding the first line at or after every index_stride bytes.
+// The index is cached next to the file as <path>.idx and rebuilt when the file changes.
+class LogSegment {
+public:
+    explicit LogSegment(std::string path, size_t index_stride = kDefaultIndexStride) : path_(std::move(path)), index_stride_(std::max<size_t>(index_stride, 1)) {
+        Open();
+        if (!LoadIndex()) {
+            BuildIndex();
+            SaveIndex();
+        }
+    }
+
+    LogSegment(const LogSegment&) = delete;
+    LogSegment& operator=(const LogSegment&) = delete;
+
+    ~LogSegment() noexcept {
+        if (mapping_ != nullptr) {
+            munmap(mapping_, data_.size());
+        }
+    }
+
+    const std::string& Path() const {
+        return path_;
+    }
+
+    std::string_view Data() const {
+        return data_;
+    }
+
+    const std::vector<IndexEntry>& Index() const {
+        return index_;
+    }
+
+    std::string_view FirstTimestamp() const {
+        return index_.empty() ? std::string_view() : index_.front().Timestamp();
+    }
+
+    std::string_view LastTimestamp() const {
+        return last_timestamp_;
+    }
+
+    // False when the index shows the timestamps going backwards; First/LastTimestamp then do
+    // not bound the segment and FindRange covers all of it.
+    bool Monotonic() const {
+        return monotonic_;
+    }
+
+    // Byte range covering every line with a timestamp in [from, to), plus at most one stride of lines outside it.
+    std::pair<size_t, size_t> FindRange(std::string_view from, std::string_view to) const {
+        if (!monotonic_) {
+            return {0, data_.size()};
+        }
+        auto by_timestamp = [](const IndexEntry& entry, std::string_view key) { return entry.Timestamp() < key; };
+
+        auto first = std::lower_bound(index_.begin(), index_.end(), from, by_timestamp);
+        size_t begin = first == index_.begin() ? 0 : std::prev(first)->offset;
+
+        auto last = to.empty() ? index_.end() : std::lower_bound(index_.begin(), index_.end(), to, by_timestamp);
+        size_t end = last == index_.end() ? data_.size() : last->offset;
+        return {begin, std::max(begin, end)};
+    }
+
+private:
+    static constexpr std::string_view kIndexMagic = "MIDX1";
+
+    void Open() {
+        if (path_.ends_with(kCompressedExtension)) {
+            struct stat st {};
+            if (stat(path_.c_str(), &st) == 0 && DecompressFile(path_, inflated_)) {
+                data_ = inflated_;
+                SetFileIdentity(st);
+            }
+            return;
+        }
+
+        int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                mapping_ = mapping;
+                data_ = std::string_view(static_cast<const char*>(mapping), static_cast<size_t>(st.st_size));
+                SetFileIdentity(st);
+            }
+        }
+        close(fd);
+    }
+
+    void SetFileIdentity(const struct stat& st) {
+        file_size_ = static_cast<uint64_t>(st.st_size);
+        file_mtime_ = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    size_t NextLineStart(size_t offset) const {
+        if (offset == 0) {
+            return 0;
+        }
+        size_t newline = data_.find('\n', offset - 1);
+        return newline == std::string_view::npos ? data_.size() : newline + 1;
+    }
+
+    void BuildIndex() {
+        index_.clear();
+        size_t previous = data_.size();
+        for (size_t boundary = 0; boundary < data_.size(); boundary += index_stride_) {
+            size_t offset = NextLineStart(boundary);
+            while (offset < data_.size() && !HasTimestamp(data_.substr(offset))) {
+                offset = NextLineStart(offset + 1);
+            }
+            if (offset >= data_.size() || offset == previous) {
+                continue;
+            }
+            IndexEntry entry{offset, {}};
+            std::memcpy(entry.timestamp.data(), data_.data() + offset, kTimestampSize);
+            index_.push_back(entry);
+            previous = offset;
+        }
+        FindLastTimestamp();
+        CheckOrder();
+    }
+
+    void CheckOrder() {
+        auto by_timestamp = [](const IndexEntry& lhs, const IndexEntry& rhs) { return lhs.Timestamp() < rhs.Timestamp(); };
+        monotonic_ = std::is_sorted(index_.begin(), index_.end(), by_timestamp) && (index_.empty() || index_.back().Timestamp() <= last_timestamp_);
+    }
+
+    void FindLastTimestamp() {
+        std::string_view rest = data_;
+        while (!rest.empty()) {
+            if (rest.back() == '\n') {
+                rest.remove_suffix(1);
+            }
+            size_t start = rest.rfind('\n');
+            start = start == std::string_view::npos ? 0 : start + 1;
+            std::string_view line = rest.substr(start);
+            if (HasTimestamp(line)) {
+                last_timestamp_ = line.substr(0, kTimestampSize);
+                return;
+            }
+            rest = rest.substr(0, start);
+        }
+    }
+
+    std::string IndexPath() const {
+        return path_ + ".idx";
+    }
+
+    bool LoadIndex() {
+        std::ifstream in(IndexPath(), std::ios::binary);
+        if (!in.is_open() || data_.empty()) {
+            return false;
+        }
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::string_view input(content);
+        if (!input.starts_with(kIndexMagic)) {
+            return false;
+        }
+        input.remove_prefix(kIndexMagic.size());
+
+        uint64_t file_size = 0;
+        int64_t file_mtime = 0;
+        uint64_t stride = 0;
+        uint64_t count = 0;
+        if (!detail::GetLittleEndian(input, file_size) || !detail::GetLittleEndian(input, file_mtime) || !detail::GetLittleEndian(input, stride) ||
+            !detail::GetLittleEndian(input, count)) {
+            return false;
+        }
+        // The count comes from disk: check it against the remaining bytes before multiplying.
+        constexpr size_t kEntrySize = sizeof(uint64_t) + kTimestampSize;
+        if (file_size != file_size_ || file_mtime != file_mtime_ || stride != index_stride_ || count > input.size() / kEntrySize ||
+            input.size() != count * kEntrySize) {
+            return false;
+        }
+
+        index_.resize(count);
+        for (auto& entry : index_) {
+            detail::GetLittleEndian(input, entry.offset);
+            std::memcpy(entry.timestamp.data(), input.data(), kTimestampSize);
+            input.remove_prefix(kTimestampSize);
+            if (entry.offset >= data_.size()) {
+                index_.clear();
+                return false;
+            }
+        }
+        FindLastTimestamp();
+        CheckOrder();
+        return true;
+    }
+
+    void SaveIndex() const {
+        if (data_.empty()) {
+            return;
+        }
+        std::string out(kIndexMagic);
+        detail::PutLittleEndian<uint64_t>(out, file_size_);
+        detail::PutLittleEndian<int64_t>(out, file_mtime_);
+        detail::PutLittleEndian<uint64_t>(out, index_stride_);
+        detail::PutLittleEndian<uint64_t>(out, index_.size());
+        for (const auto& entry : index_) {
+            detail::PutLittleEndian<uint64_t>(out, entry.offset);
+            out.append(entry.timestamp.data(), kTimestampSize);
+        }
+
+        // Written aside and renamed so concurrent readers never load a torn index.
+        std::string temporary = IndexPath() + ".tmp";
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (file.write(out.data(), static_cast<std::streamsize>(out.size())) && (file.close(), !file.fail())) {
+            std::rename(temporary.c_str(), IndexPath().c_str());
+        } else {
+            std::remove(temporary.c_str());
+        }
+    }
+
+    const std::string path_;
+    const size_t index_stride_;
+    void* mapping_ = nullptr;
+    std::string inflated_;
+    std::string_view data_;
+    uint64_t file_size_ = 0;
+    int64_t file_mtime_ = 0;
+    std::vector<IndexEntry> index_;
+    std::string_view last_timestamp_;
+    bool monotonic_ = true;
+};
+
+// Time-range queries over a set of log segments (the active file and its rotated segments).
+// Matching byte ranges are cut into chunks at line boundaries and parsed on several threads;
+// records are still delivered in file order.
+class LogReader {
+public:
+    explicit LogReader(const std::vector<std::string>& paths, size_t index_stride = kDefaultIndexStride) {
+        for (const auto& path : paths) {
+            if (path.ends_with(".idx") || path.ends_with(".next") || path.ends_with(".tmp")) {
+                continue;
+            }
+            auto segment = std::make_unique<LogSegment>(path, index_stride);
+            if (!segment->Index().empty()) {
+                segments_.push_back(std::move(segment));
+            }
+        }
+        std::stable_sort(segments_.begin(), segments_.end(), [](const auto& lhs, const auto& rhs) { return lhs->FirstTimestamp() < rhs->FirstTimestamp(); });
+    }
+
+    const std::vector<std::unique_ptr<LogSegment>>& Segments() const {
+        return segments_;
+    }
+
+    // Empty bounds are open; an empty metric matches every name.
+    void Query(std::string_view from, std::string_view to, std::string_view metric, const std::function<void(const MetricRecord&)>& callback,
+               size_t num_threads = std::max(1u, std::thread::hardware_concurrency())) const {
+        std::vector<Chunk> chunks;
+        for (const auto& segment : segments_) {
+            if (segment->Monotonic() && ((!to.empty() && segment->FirstTimestamp() >= to) || segment->LastTimestamp() < from)) {
+                continue;
+            }
+            auto [begin, end] = segment->FindRange(from, to);
+            SplitIntoChunks(segment->Data(), begin, end, chunks);
+        }
+
+        // Chunks are parsed a wave at a time so memory stays bounded by num_threads chunks.
+        num_threads = std::max<size_t>(num_threads, 1);
+        for (size_t wave = 0; wave < chunks.size(); wave += num_threads) {
+            size_t wave_end = std::min(chunks.size(), wave + num_threads);
+            std::vector<std::vector<MetricRecord>> results(wave_end - wave);
+
+            std::vector<std::thread> workers;
+            for (size_t i = wave + 1; i < wave_end; ++i) {
+                workers.emplace_back([&, i] { ScanChunk(chunks[i], from, to, metric, results[i - wave]); });
+            }
+            ScanChunk(chunks[wave], from, to, metric, results[0]);
+            for (auto& worker : workers) {
+                worker.join();
+            }
+
+            for (const auto& records : results) {
+                for (const auto& record : records) {
+                    callback(record);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kChunkSize = 4 << 20;
+
+    using Chunk = std::string_view;
+
+    static void SplitIntoChunks(std::string_view data, size_t begin, size_t end, std::vector<Chunk>& chunks) {
+        while (begin < end) {
+            size_t split = end;
+            if (end - begin > kChunkSize) {
+                size_t newline = data.find('\n', begin + kChunkSize);
+                split = newline == std::string_view::npos ? end : std::min(end, newline + 1);
+            }
+            chunks.push_back(data.substr(begin, split - begin));
+            begin = split;
+        }
+    }
+
+    static void ScanChunk(std::string_view chunk, std::string_view from, std::string_view to, std::string_view metric, std::vector<MetricRecord>& records) {
+        while (!chunk.empty()) {
+            size_t newline = std::min(chunk.find('\n'), chunk.size());
+            std::string_view line = chunk.substr(0, newline);
+            chunk.remove_prefix(std::min(newline + 1, chunk.size()));
+
+            if (!HasTimestamp(line)) {
+                continue;
+            }
+            std::string_view timestamp = line.substr(0, kTimestampSize);
+            if (timestamp < from || (!to.empty() && timestamp >= to)) {
+                continue;
+            }
+            ParseLine(line, [&](const MetricRecord& record) {
+                if (metric.empty() || record.name == metric) {
+                    records.push_back(record);
+                }
+            });
+        }
+    }
+
+    std::vector<std::unique_ptr<LogSegment>> segments_;
+};
+
+}  // namespace metrics
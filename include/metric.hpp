@@ -1,28 +1,58 @@
 #pragma once
 
+#include "seqlock.hpp"
+
 #include <string>
 #include <atomic>
+#include <chrono>
+#include <optional>
 #include <variant>
 
 namespace metrics {
 
 using MetricValue = std::variant<int64_t, double>;
 
+struct MetricSnapshot {
+    std::string name;
+    MetricValue value;
+    std::chrono::system_clock::time_point timestamp;
+};
+
 class IMetric {
 public:
     virtual ~IMetric() = default;
     virtual std::string GetName() const = 0;
+    // Delta since the previous GetAndReset. Meant for a single consumer.
     virtual MetricValue GetAndReset() = 0;
     virtual bool HasValue() const = 0;
+    // Cumulative value; changes nothing, so any number of readers may call it concurrently.
+    // Empty when there is nothing to report: by default (metrics without a cumulative view)
+    // and for a gauge that was never set. A counter always has a total, 0 until incremented.
+    virtual std::optional<MetricValue> Read() const {
+        return std::nullopt;
+    }
 };
 
+// Keeps a running total that is never reset; GetAndReset reports the difference to the
+// total it returned last time.
 class Counter : public IMetric {
 public:
-    explicit Counter(std::string name) : name_(std::move(name)), value_(0) {
+    explicit Counter(std::string name) : name_(std::move(name)), total_(0), reported_(0) {
     }
 
     void Increment(int64_t delta = 1) {
-        value_.fetch_add(delta);
+        total_.fetch_add(delta);
+    }
+
+    // Adds a total carried over from a previous run (see CounterCheckpoint). It shows up in
+    // Total and Read but is never reported as a delta. Call before the counter is registered.
+    void Restore(int64_t total) {
+        reported_.fetch_add(total);
+        total_.fetch_add(total);
+    }
+
+    int64_t Total() const {
+        return total_.load();
     }
 
     std::string GetName() const override {
@@ -30,46 +60,88 @@ public:
     }
 
     MetricValue GetAndReset() override {
-        return value_.exchange(0);
+        int64_t total = total_.load();
+        return total - reported_.exchange(total);
     }
 
     bool HasValue() const override {
-        return value_.load() != 0;
+        return total_.load() != reported_.load();
+    }
+
+    std::optional<MetricValue> Read() const override {
+        return total_.load();
     }
 
 private:
     std::string name_;
-    std::atomic_int64_t value_;
+    std::atomic_int64_t total_;
+    std::atomic_int64_t reported_;
+};
+
+struct GaugeReading {
+    double value = 0;
+    // Number of Set calls so far.
+    uint64_t updates = 0;
 };
 
+// Value and update count are written together under a SeqLock, so readers always see a
+// value with the count of the Set that wrote it.
 class Gauge : public IMetric {
 public:
-    explicit Gauge(std::string name) : name_(std::move(name)), has_value_(false) {
+    explicit Gauge(std::string name) : name_(std::move(name)), value_(0), updates_(0), reported_updates_(0) {
     }
 
+    // One uncontended CAS and a few plain stores. Concurrent Set calls on the same gauge
+    // serialize on the SeqLock and spin (with backoff) while another writer is inside, so a
+    // gauge written from many threads at once costs more than a Counter.
     void Set(double value) {
-        value_.store(value);
-        has_value_.store(true);
+        lock_.WriteLock();
+        value_.store(value, std::memory_order_release);
+        updates_.store(updates_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        lock_.WriteUnlock();
+    }
+
+    GaugeReading Snapshot() const {
+        GaugeReading reading;
+        uint64_t sequence;
+        do {
+            sequence = lock_.ReadBegin();
+            reading.value = value_.load(std::memory_order_acquire);
+            reading.updates = updates_.load(std::memory_order_acquire);
+        } while (lock_.ReadRetry(sequence));
+        return reading;
     }
 
     std::string GetName() const override {
         return name_;
     }
 
+    // A Set racing with this call bumps the update count past the one recorded here, so
+    // HasValue stays true and the new value is reported next time instead of being lost.
     MetricValue GetAndReset() override {
-        double val = value_.load();
-        has_value_.store(false);
-        return val;
+        GaugeReading reading = Snapshot();
+        reported_updates_.store(reading.updates);
+        return reading.value;
     }
 
     bool HasValue() const override {
-        return has_value_.load();
+        return updates_.load() != reported_updates_.load();
+    }
+
+    std::optional<MetricValue> Read() const override {
+        GaugeReading reading = Snapshot();
+        if (reading.updates == 0) {
+            return std::nullopt;
+        }
+        return reading.value;
     }
 
 private:
     std::string name_;
+    SeqLock lock_;
     std::atomic<double> value_;
-    std::atomic_bool has_value_;
+    std::atomic_uint64_t updates_;
+    std::atomic_uint64_t reported_updates_;
 };
 
 }  // namespace metrics
@@ -2,65 +2,111 @@
 
 #include "metric.hpp"
 #include "lock_free_queue.hpp"
+#include "fan_out.hpp"
+#include "file_sink.hpp"
+#include "shared_collector.hpp"
 
 #include <memory>
+#include <mutex>
 #include <vector>
-#include <fstream>
 #include <thread>
 #include <atomic>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <optional>
 
 namespace metrics {
 
-struct MetricSnapshot {
-    std::string name;
-    MetricValue value;
-    std::chrono::system_clock::time_point timestamp;
+enum class CollectionMode {
+    // Report what changed since the previous flush and reset the metrics (GetAndReset).
+    kDelta,
+    // Report the cumulative value of every metric that has one (Read). Nothing is reset, so
+    // the metrics can be shared with other loggers and exporters.
+    kCumulative,
 };
 
 class MetricsLogger {
 public:
-    explicit MetricsLogger(std::string filename, std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000))
-        : filename_(std::move(filename)), flush_interval_(flush_interval), running_(true) {
+    explicit MetricsLogger(std::string filename, std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000)) : flush_interval_(flush_interval), running_(true) {
+        fan_out_.AddSink(std::make_shared<FileSink>(std::move(filename)));
+        output_thread_ = std::thread(&MetricsLogger::OutputLoop, this);
+    }
 
+    // Logger without the default log file; output goes only to sinks added with AddSink.
+    explicit MetricsLogger(std::chrono::milliseconds flush_interval) : flush_interval_(flush_interval), running_(true) {
         output_thread_ = std::thread(&MetricsLogger::OutputLoop, this);
     }
 
+    // Loggers attached to a SharedCollector have no thread of their own: the collector
+    // flushes them on its ticks and runs their sinks. The collector must outlive the logger.
+    MetricsLogger(std::string filename, SharedCollector& collector, std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000))
+        : flush_interval_(flush_interval), fan_out_(&collector), running_(true), collector_(&collector) {
+        fan_out_.AddSink(std::make_shared<FileSink>(std::move(filename)));
+        task_id_ = collector_->Schedule(flush_interval_, [this] { Flush(); });
+    }
+
+    MetricsLogger(SharedCollector& collector, std::chrono::milliseconds flush_interval)
+        : flush_interval_(flush_interval), fan_out_(&collector), running_(true), collector_(&collector) {
+        task_id_ = collector_->Schedule(flush_interval_, [this] { Flush(); });
+    }
+
     ~MetricsLogger() noexcept {
         Stop();
     }
 
     void RegisterMetric(std::shared_ptr<IMetric> metric) {
+        std::lock_guard lock(metrics_mutex_);
         metrics_.emplace_back(std::move(metric));
     }
 
+    void AddSink(std::shared_ptr<ISink> sink, SinkOptions options = {}) {
+        fan_out_.AddSink(std::move(sink), options);
+    }
+
+    void SetCollectionMode(CollectionMode mode) {
+        mode_.store(mode);
+    }
+
+    uint64_t DroppedBatches() const {
+        return fan_out_.Dropped();
+    }
+
+    // Snapshots that did not fit into the queue; their values are lost.
+    uint64_t DroppedSnapshots() const {
+        return dropped_snapshots_.load();
+    }
+
+    // Collects the registered metrics and publishes them as one batch right away. Safe to call
+    // alongside the logger's own periodic flush; concurrent flushes run one after another, so
+    // each collection stays a single batch and batches are published in order.
+    void Flush() noexcept {
+        std::lock_guard lock(flush_mutex_);
+        CollectMetrics();
+        WriteSnapshots();
+    }
+
     void Stop() noexcept {
         bool expected = true;
         if (running_.compare_exchange_strong(expected, false)) {
             if (output_thread_.joinable()) {
                 output_thread_.join();
             }
+            if (collector_) {
+                collector_->Cancel(task_id_);
+                Flush();
+            }
+            fan_out_.Stop();
         }
     }
 
 private:
     void OutputLoop() noexcept {
         try {
-            std::ofstream file(filename_, std::ios::app);
-            if (!file.is_open()) {
-                return;
-            }
-
             while (running_.load()) {
-                CollectMetrics();
-                WriteSnapshots(file);
+                Flush();
                 std::this_thread::sleep_for(flush_interval_);
             }
 
-            CollectMetrics();
-            WriteSnapshots(file);
+            Flush();
         } catch (...) {
         }
     }
@@ -68,18 +114,28 @@ private:
     void CollectMetrics() noexcept {
         try {
             auto now = std::chrono::system_clock::now();
+            bool cumulative = mode_.load() == CollectionMode::kCumulative;
+            std::lock_guard lock(metrics_mutex_);
 
             for (const auto& metric : metrics_) {
-                if (metric && metric->HasValue()) {
-                    MetricSnapshot snapshot{metric->GetName(), metric->GetAndReset(), now};
-                    queue_.Enqueue(std::move(snapshot));
+                if (!metric) {
+                    continue;
+                }
+                std::optional<MetricValue> value;
+                if (cumulative) {
+                    value = metric->Read();
+                } else if (metric->HasValue()) {
+                    value = metric->GetAndReset();
+                }
+                if (value && !queue_.Enqueue(MetricSnapshot{metric->GetName(), *value, now})) {
+                    ++dropped_snapshots_;
                 }
             }
         } catch (...) {
         }
     }
 
-    void WriteSnapshots(std::ofstream& file) noexcept {
+    void WriteSnapshots() noexcept {
         try {
             std::vector<MetricSnapshot> snapshots;
             snapshots.reserve(64);
@@ -89,39 +145,23 @@ private:
                 snapshots.push_back(std::move(snapshot));
             }
 
-            if (snapshots.empty()) {
-                return;
-            }
-
-            auto timestamp = snapshots[0].timestamp;
-            file << FormatTimestamp(timestamp);
-
-            for (const auto& snap : snapshots) {
-                file << " \"" << snap.name << "\" ";
-                std::visit([&file](const auto& value) { file << value; }, snap.value);
-            }
-            file << "\n";
-            file.flush();
+            fan_out_.Publish(snapshots);
         } catch (...) {
         }
     }
 
-    std::string FormatTimestamp(const std::chrono::system_clock::time_point& tp) const {
-        auto time_t = std::chrono::system_clock::to_time_t(tp);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()) % 1000;
-
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-        ss << "." << std::setfill('0') << std::setw(3) << ms.count();
-        return ss.str();
-    }
-
-    const std::string filename_;
     const std::chrono::milliseconds flush_interval_;
+    std::mutex flush_mutex_;
+    std::mutex metrics_mutex_;
     std::vector<std::shared_ptr<IMetric>> metrics_;
     MPMCBoundedQueue<MetricSnapshot, 4096> queue_;
+    std::atomic_uint64_t dropped_snapshots_{0};
+    std::atomic<CollectionMode> mode_{CollectionMode::kDelta};
+    FanOut fan_out_;
     std::atomic<bool> running_;
     std::thread output_thread_;
+    SharedCollector* const collector_ = nullptr;
+    SharedCollector::TaskId task_id_ = 0;
 };
 
 }  // namespace metrics
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace metrics {
+
+namespace detail {
+
+// Busy-wait step: a CPU pause for short waits, then yields so a preempted lock holder can run.
+class SpinBackoff {
+public:
+    void Pause() noexcept {
+        if (spins_ < kSpinsBeforeYield) {
+            ++spins_;
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#endif
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    static constexpr int kSpinsBeforeYield = 64;
+    int spins_ = 0;
+};
+
+}  // namespace detail
+
+// Sequence lock for small groups of fields that are read much more often than written.
+// Readers never block writers and never write shared memory: they copy the fields and retry
+// if the sequence was odd (write in progress) or changed meanwhile. Writers serialize on the
+// sequence itself, so any number of threads may write; they and readers spin with backoff
+// while a write is in progress.
+//
+// Protected fields must be atomics that writers store with release and readers load with
+// acquire ordering: a reader that sees any new field value then also sees the odd sequence
+// and retries. On x86 these are plain moves, and no standalone fences are needed.
+//
+//   uint64_t seq;
+//   do {
+//       seq = lock.ReadBegin();
+//       ... copy fields ...
+//   } while (lock.ReadRetry(seq));
+class SeqLock {
+public:
+    void WriteLock() noexcept {
+        detail::SpinBackoff backoff;
+        uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+        while ((sequence & 1) != 0 || !sequence_.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            backoff.Pause();
+            sequence = sequence_.load(std::memory_order_relaxed);
+        }
+    }
+
+    void WriteUnlock() noexcept {
+        // Only the lock holder changes an odd sequence, so no read-modify-write is needed.
+        sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint64_t ReadBegin() const noexcept {
+        detail::SpinBackoff backoff;
+        uint64_t sequence = sequence_.load(std::memory_order_acquire);
+        while ((sequence & 1) != 0) {
+            backoff.Pause();
+            sequence = sequence_.load(std::memory_order_acquire);
+        }
+        return sequence;
+    }
+
+    // True when the fields copied since ReadBegin may be torn and must be read again.
+    bool ReadRetry(uint64_t sequence) const noexcept {
+        return sequence_.load(std::memory_order_relaxed) != sequence;
+    }
+
+private:
+    std::atomic_uint64_t sequence_{0};
+};
+
+}  // namespace metrics
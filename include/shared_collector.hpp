@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace metrics {
+
+// Runs periodic tasks for many loggers on one thread or a small pool.
+// Tick times are aligned to multiples of the interval, so every task with the same
+// interval becomes due at the same instant and is served by a single wakeup.
+// One-shot tasks posted with Post (used for sink delivery) run on a separate delivery
+// thread, so a slow sink never delays the ticks.
+class SharedCollector {
+public:
+    using TaskId = uint64_t;
+
+    explicit SharedCollector(size_t num_threads = 1) : num_threads_(std::max<size_t>(num_threads, 1)) {
+        threads_.reserve(num_threads_);
+        for (size_t i = 0; i < num_threads_; ++i) {
+            threads_.emplace_back(&SharedCollector::Loop, this);
+        }
+        delivery_thread_ = std::thread(&SharedCollector::DeliveryLoop, this);
+    }
+
+    SharedCollector(const SharedCollector&) = delete;
+    SharedCollector& operator=(const SharedCollector&) = delete;
+
+    ~SharedCollector() noexcept {
+        Stop();
+    }
+
+    TaskId Schedule(std::chrono::milliseconds interval, std::function<void()> task) {
+        interval = std::max(interval, std::chrono::milliseconds(1));
+        std::lock_guard lock(mutex_);
+        TaskId id = next_id_++;
+        entries_.emplace(id, Entry{interval, NextTick(std::chrono::steady_clock::now(), interval), std::move(task), false});
+        cv_.notify_all();
+        return id;
+    }
+
+    // Waits for a run of the task that is already in progress. Must not be called from the task itself.
+    void Cancel(TaskId id) {
+        std::unique_lock lock(mutex_);
+        auto it = entries_.find(id);
+        if (it == entries_.end()) {
+            return;
+        }
+        cv_.wait(lock, [this, id] { return !entries_.at(id).running; });
+        entries_.erase(id);
+    }
+
+    // Runs the task on the delivery thread, or inline once the collector has stopped.
+    void Post(std::function<void()> task) {
+        {
+            std::lock_guard lock(delivery_mutex_);
+            if (!delivery_stopped_) {
+                posted_.push_back(std::move(task));
+                delivery_cv_.notify_one();
+                return;
+            }
+        }
+        task();
+    }
+
+    // Joins the pool, then runs every task posted so far (including those posted by the
+    // last ticks) and joins the delivery thread. Scheduled tasks are not run again.
+    void Stop() noexcept {
+        {
+            std::lock_guard lock(mutex_);
+            if (stopped_) {
+                return;
+            }
+            stopped_ = true;
+        }
+        cv_.notify_all();
+        for (auto& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+
+        {
+            std::lock_guard lock(delivery_mutex_);
+            delivery_stopped_ = true;
+        }
+        delivery_cv_.notify_one();
+        if (delivery_thread_.joinable()) {
+            delivery_thread_.join();
+        }
+    }
+
+private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct Entry {
+        std::chrono::milliseconds interval;
+        TimePoint next_due;
+        std::function<void()> task;
+        bool running;
+    };
+
+    static TimePoint NextTick(TimePoint now, std::chrono::milliseconds interval) {
+        auto ticks = now.time_since_epoch() / interval;
+        return TimePoint(std::chrono::duration_cast<TimePoint::duration>(interval * (ticks + 1)));
+    }
+
+    void Loop() noexcept {
+        std::unique_lock lock(mutex_);
+        while (true) {
+            if (stopped_) {
+                return;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            std::vector<TaskId> due;
+            TimePoint wake_at = TimePoint::max();
+            for (const auto& [id, entry] : entries_) {
+                if (entry.running) {
+                    continue;
+                }
+                if (entry.next_due <= now) {
+                    due.push_back(id);
+                } else {
+                    wake_at = std::min(wake_at, entry.next_due);
+                }
+            }
+
+            if (due.empty()) {
+                if (wake_at == TimePoint::max()) {
+                    cv_.wait(lock);
+                } else {
+                    cv_.wait_until(lock, wake_at);
+                }
+                continue;
+            }
+
+            // Split a combined tick across idle pool threads; a single thread serves all of it.
+            size_t share = (due.size() + num_threads_ - 1) / num_threads_;
+            due.resize(share);
+            std::vector<std::function<void()>*> tasks;
+            for (TaskId id : due) {
+                Entry& entry = entries_.at(id);
+                entry.running = true;
+                entry.next_due = NextTick(now, entry.interval);
+                tasks.push_back(&entry.task);
+            }
+            cv_.notify_all();
+
+            lock.unlock();
+            for (auto* task : tasks) {
+                Run(*task);
+            }
+            lock.lock();
+
+            for (TaskId id : due) {
+                entries_.at(id).running = false;
+            }
+            cv_.notify_all();
+        }
+    }
+
+    void DeliveryLoop() noexcept {
+        std::unique_lock lock(delivery_mutex_);
+        while (true) {
+            delivery_cv_.wait(lock, [this] { return delivery_stopped_ || !posted_.empty(); });
+            if (posted_.empty()) {
+                return;
+            }
+
+            auto task = std::move(posted_.front());
+            posted_.pop_front();
+            lock.unlock();
+            Run(task);
+            lock.lock();
+        }
+    }
+
+    static void Run(const std::function<void()>& task) noexcept {
+        try {
+            task();
+        } catch (...) {
+        }
+    }
+
+    const size_t num_threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::map<TaskId, Entry> entries_;
+    TaskId next_id_ = 0;
+    bool stopped_ = false;
+    std::vector<std::thread> threads_;
+
+    std::mutex delivery_mutex_;
+    std::condition_variable delivery_cv_;
+    std::deque<std::function<void()>> posted_;
+    bool delivery_stopped_ = false;
+    std::thread delivery_thread_;
+};
+
+}  // namespace metrics
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "format.hpp"
+
+namespace metrics {
+
+class ISink {
+public:
+    virtual ~ISink() = default;
+    virtual Format GetFormat() const = 0;
+    virtual void Write(const SharedBuffer& buffer) = 0;
+};
+
+}  // namespace metrics
@@ -0,0 +1,208 @@
+#pragma once
+
+#include "format.hpp"
+#include "sink.hpp"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+
+namespace metrics {
+
+// Streams every batch as a length-prefixed binary frame (see format.hpp) to a local agent.
+// Queued frames reference the shared formatted buffer, so nothing is copied before the gather write.
+// The socket is non-blocking: whatever the agent does not accept stays in a bounded backlog
+// (oldest frames are dropped first) and is retried on the next Write.
+class UnixSocketSink : public ISink {
+public:
+    explicit UnixSocketSink(std::string socket_path, size_t max_backlog_bytes = 1 << 20, std::chrono::milliseconds max_backoff = std::chrono::milliseconds(5000))
+        : socket_path_(std::move(socket_path)), max_backlog_bytes_(max_backlog_bytes), max_backoff_(max_backoff), backoff_(kInitialBackoff) {
+    }
+
+    UnixSocketSink(const UnixSocketSink&) = delete;
+    UnixSocketSink& operator=(const UnixSocketSink&) = delete;
+
+    ~UnixSocketSink() noexcept override {
+        SendBacklog();
+        Disconnect();
+    }
+
+    Format GetFormat() const override {
+        return Format::kBinary;
+    }
+
+    void Write(const SharedBuffer& buffer) override {
+        if (buffer->empty()) {
+            return;
+        }
+
+        Frame frame{EncodeFrameHeader(static_cast<uint32_t>(buffer->size())), buffer};
+        backlog_bytes_ += frame.Size();
+        backlog_.push_back(std::move(frame));
+        TrimBacklog();
+
+        SendBacklog();
+    }
+
+    bool Connected() const {
+        return fd_ >= 0;
+    }
+
+    size_t BacklogBytes() const {
+        return backlog_bytes_.load();
+    }
+
+    uint64_t DroppedFrames() const {
+        return dropped_frames_.load();
+    }
+
+private:
+    struct Frame {
+        FrameHeader header;
+        SharedBuffer payload;
+
+        size_t Size() const {
+            return kFrameHeaderSize + payload->size();
+        }
+    };
+
+    static constexpr std::chrono::milliseconds kInitialBackoff{50};
+    static constexpr size_t kMaxFramesPerWrite = 64;
+
+    bool Connect() {
+        auto now = std::chrono::steady_clock::now();
+        if (now < next_connect_attempt_) {
+            return false;
+        }
+
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (socket_path_.size() >= sizeof(addr.sun_path)) {
+            return false;
+        }
+        std::memcpy(addr.sun_path, socket_path_.c_str(), socket_path_.size() + 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            ScheduleReconnect(now);
+            return false;
+        }
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close(fd);
+            ScheduleReconnect(now);
+            return false;
+        }
+
+        fd_ = fd;
+        backoff_ = kInitialBackoff;
+        return true;
+    }
+
+    void ScheduleReconnect(std::chrono::steady_clock::time_point now) {
+        next_connect_attempt_ = now + backoff_;
+        backoff_ = std::min(backoff_ * 2, max_backoff_);
+    }
+
+    void Disconnect() {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        // The agent never saw the tail of a partially sent frame, so resend it whole.
+        front_offset_ = 0;
+    }
+
+    void SendBacklog() {
+        while (!backlog_.empty()) {
+            if (fd_ < 0 && !Connect()) {
+                return;
+            }
+
+            iovec iov[kMaxFramesPerWrite * 2];
+            size_t iov_count = 0;
+            size_t skip = front_offset_;
+            for (size_t i = 0; i < backlog_.size() && i < kMaxFramesPerWrite; ++i) {
+                const Frame& frame = backlog_[i];
+                AppendIov(iov, iov_count, frame.header.data(), kFrameHeaderSize, skip);
+                AppendIov(iov, iov_count, frame.payload->data(), frame.payload->size(), skip);
+            }
+
+            // sendmsg is writev with MSG_NOSIGNAL, so a vanished agent yields EPIPE instead of SIGPIPE.
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iov_count;
+            ssize_t written = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    Disconnect();
+                    ScheduleReconnect(std::chrono::steady_clock::now());
+                }
+                return;
+            }
+            Consume(static_cast<size_t>(written));
+        }
+    }
+
+    static void AppendIov(iovec* iov, size_t& iov_count, const char* data, size_t size, size_t& skip) {
+        if (skip >= size) {
+            skip -= size;
+            return;
+        }
+        iov[iov_count].iov_base = const_cast<char*>(data + skip);
+        iov[iov_count].iov_len = size - skip;
+        ++iov_count;
+        skip = 0;
+    }
+
+    void Consume(size_t written) {
+        while (written > 0 && !backlog_.empty()) {
+            size_t remaining = backlog_.front().Size() - front_offset_;
+            if (written < remaining) {
+                front_offset_ += written;
+                return;
+            }
+            written -= remaining;
+            backlog_bytes_ -= backlog_.front().Size();
+            backlog_.pop_front();
+            front_offset_ = 0;
+        }
+    }
+
+    void TrimBacklog() {
+        // A partially sent front frame must be completed, otherwise the stream loses framing.
+        size_t keep_front = front_offset_ > 0 ? 1 : 0;
+        while (backlog_bytes_.load() > max_backlog_bytes_ && backlog_.size() > keep_front + 1) {
+            auto victim = backlog_.begin() + static_cast<std::ptrdiff_t>(keep_front);
+            backlog_bytes_ -= victim->Size();
+            backlog_.erase(victim);
+            ++dropped_frames_;
+        }
+    }
+
+    const std::string socket_path_;
+    const size_t max_backlog_bytes_;
+    const std::chrono::milliseconds max_backoff_;
+    std::chrono::milliseconds backoff_;
+    std::chrono::steady_clock::time_point next_connect_attempt_{};
+    std::atomic_int fd_{-1};
+    std::deque<Frame> backlog_;
+    size_t front_offset_ = 0;
+    std::atomic_size_t backlog_bytes_{0};
+    std::atomic_uint64_t dropped_frames_{0};
+};
+
+}  // namespace metrics
@@ -0,0 +1,254 @@
+// End-to-end load simulation: measures what MetricsLogger costs instrumented threads.
+//
+// Runs N worker threads doing synthetic work twice: once uninstrumented (baseline) and once
+// updating M metrics while a logger flushes them to a file. Reports the worker slowdown, the
+// flush timing jitter, the output rate and the snapshots/batches lost on the way.
+//
+//   metrics_loadgen [--threads N] [--metrics M] [--updates K] [--work ITERATIONS] [--interval MS]
+//                   [--duration SECONDS] [--output FILE] [--shared-collector] [--max-slowdown PERCENT]
+//
+// With --max-slowdown the exit status is 2 when the slowdown exceeds the given percentage.
+
+#include "../include/metrics_logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+    size_t threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    size_t metrics = 64;
+    size_t updates = 4;
+    size_t work = 200;
+    std::chrono::milliseconds interval{100};
+    std::chrono::seconds duration{5};
+    std::string output = "loadgen_metrics.log";
+    bool shared_collector = false;
+    double max_slowdown = -1;
+};
+
+// Records when each batch reaches the sinks and how large it is. Shares the text buffer
+// with the file sink, so it adds no formatting work.
+class MeasuringSink : public metrics::ISink {
+public:
+    metrics::Format GetFormat() const override {
+        return metrics::Format::kText;
+    }
+
+    void Write(const metrics::SharedBuffer& buffer) override {
+        std::lock_guard lock(mutex_);
+        arrivals_.push_back(Clock::now());
+        bytes_ += buffer->size();
+    }
+
+    std::vector<Clock::time_point> Arrivals() {
+        std::lock_guard lock(mutex_);
+        return arrivals_;
+    }
+
+    uint64_t Bytes() {
+        std::lock_guard lock(mutex_);
+        return bytes_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Clock::time_point> arrivals_;
+    uint64_t bytes_ = 0;
+};
+
+struct Registry {
+    std::vector<std::shared_ptr<metrics::Counter>> counters;
+    std::vector<std::shared_ptr<metrics::Gauge>> gauges;
+};
+
+uint64_t SyntheticWork(uint64_t state, size_t iterations) {
+    for (size_t i = 0; i < iterations; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+    }
+    return state;
+}
+
+// Returns completed requests per second over all workers.
+double RunWorkers(const Config& config, const Registry* registry) {
+    std::atomic_bool stop{false};
+    std::atomic_uint64_t requests{0};
+    // Keeps the synthetic work observable so it is not optimized away.
+    std::atomic_uint64_t checksum{0};
+
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < config.threads; ++t) {
+        workers.emplace_back([&, t] {
+            uint64_t state = t * 0x9e3779b97f4a7c15ull + 1;
+            uint64_t done = 0;
+            size_t next_metric = t;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 64; ++i) {
+                    state = SyntheticWork(state, config.work);
+                    if (registry) {
+                        for (size_t u = 0; u < config.updates; ++u) {
+                            size_t index = next_metric++ % config.metrics;
+                            if (index % 2 == 0) {
+                                registry->counters[index / 2]->Increment();
+                            } else {
+                                registry->gauges[index / 2]->Set(static_cast<double>(state & 0xffff));
+                            }
+                        }
+                    }
+                }
+                done += 64;
+            }
+            requests += done;
+            checksum ^= state;
+        });
+    }
+
+    auto start = Clock::now();
+    std::this_thread::sleep_for(config.duration);
+    stop.store(true);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(requests.load()) / seconds;
+}
+
+bool ParseArgs(int argc, char** argv, Config& config) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--shared-collector") {
+            config.shared_collector = true;
+        } else if (!has_value) {
+            return false;
+        } else if (arg == "--threads") {
+            config.threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--metrics") {
+            config.metrics = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--updates") {
+            config.updates = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--work") {
+            config.work = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--interval") {
+            config.interval = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--duration") {
+            config.duration = std::chrono::seconds(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--output") {
+            config.output = argv[++i];
+        } else if (arg == "--max-slowdown") {
+            config.max_slowdown = std::strtod(argv[++i], nullptr);
+        } else {
+            return false;
+        }
+    }
+    return config.threads > 0 && config.metrics > 0 && config.interval.count() > 0 && config.duration.count() > 0;
+}
+
+void PrintJitter(const std::vector<Clock::time_point>& arrivals, std::chrono::milliseconds interval) {
+    if (arrivals.size() < 2) {
+        std::cout << "flush jitter:         not enough flushes" << std::endl;
+        return;
+    }
+
+    double expected = static_cast<double>(interval.count());
+    double sum = 0;
+    double sum_squares = 0;
+    double max_deviation = 0;
+    for (size_t i = 1; i < arrivals.size(); ++i) {
+        double gap = std::chrono::duration<double, std::milli>(arrivals[i] - arrivals[i - 1]).count();
+        sum += gap;
+        sum_squares += gap * gap;
+        max_deviation = std::max(max_deviation, std::abs(gap - expected));
+    }
+    auto n = static_cast<double>(arrivals.size() - 1);
+    double mean = sum / n;
+    double stddev = std::sqrt(std::max(0.0, sum_squares / n - mean * mean));
+    std::cout << "flush interval:       mean " << mean << " ms, stddev " << stddev << " ms, max deviation " << max_deviation << " ms" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Config config;
+    if (!ParseArgs(argc, argv, config)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--threads N] [--metrics M] [--updates K] [--work ITERATIONS] [--interval MS] [--duration SECONDS] [--output FILE] [--shared-collector]"
+                     " [--max-slowdown PERCENT]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "workers: " << config.threads << ", metrics: " << config.metrics << ", updates/request: " << config.updates << ", work: " << config.work
+              << ", interval: " << config.interval.count() << " ms, duration: " << config.duration.count() << " s" << (config.shared_collector ? ", shared collector" : "")
+              << std::endl;
+
+    double baseline = RunWorkers(config, nullptr);
+
+    Registry registry;
+    for (size_t i = 0; i < config.metrics; ++i) {
+        if (i % 2 == 0) {
+            registry.counters.push_back(std::make_shared<metrics::Counter>("loadgen_counter_" + std::to_string(i / 2)));
+        } else {
+            registry.gauges.push_back(std::make_shared<metrics::Gauge>("loadgen_gauge_" + std::to_string(i / 2)));
+        }
+    }
+
+    auto measuring_sink = std::make_shared<MeasuringSink>();
+    std::unique_ptr<metrics::SharedCollector> collector;
+    std::unique_ptr<metrics::MetricsLogger> logger;
+    if (config.shared_collector) {
+        collector = std::make_unique<metrics::SharedCollector>();
+        logger = std::make_unique<metrics::MetricsLogger>(config.output, *collector, config.interval);
+    } else {
+        logger = std::make_unique<metrics::MetricsLogger>(config.output, config.interval);
+    }
+    logger->AddSink(measuring_sink);
+    for (const auto& counter : registry.counters) {
+        logger->RegisterMetric(counter);
+    }
+    for (const auto& gauge : registry.gauges) {
+        logger->RegisterMetric(gauge);
+    }
+
+    auto start = Clock::now();
+    double instrumented = RunWorkers(config, &registry);
+    // Taken before Stop: its final flush comes at an arbitrary point of the interval and
+    // would skew the jitter figures.
+    auto arrivals = measuring_sink->Arrivals();
+    logger->Stop();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    double slowdown = baseline > 0 ? (1 - instrumented / baseline) * 100 : 0;
+
+    std::cout << "baseline:             " << baseline / 1e6 << " M requests/s" << std::endl;
+    std::cout << "instrumented:         " << instrumented / 1e6 << " M requests/s" << std::endl;
+    std::cout << "slowdown:             " << slowdown << " %" << std::endl;
+    std::cout << "flushes:              " << arrivals.size() << " (expected ~" << static_cast<uint64_t>(seconds * 1000 / static_cast<double>(config.interval.count())) << ")"
+              << std::endl;
+    PrintJitter(arrivals, config.interval);
+    std::cout << "output:               " << static_cast<double>(measuring_sink->Bytes()) / seconds / 1024 << " KiB/s" << std::endl;
+    std::cout << "lost snapshots:       " << logger->DroppedSnapshots() << " (queue overflow)" << std::endl;
+    std::cout << "dropped batches:      " << logger->DroppedBatches() << " (sink backpressure)" << std::endl;
+
+    if (config.max_slowdown >= 0 && slowdown > config.max_slowdown) {
+        std::cerr << "slowdown " << slowdown << " % exceeds the limit of " << config.max_slowdown << " %" << std::endl;
+        return 2;
+    }
+    return 0;
+}
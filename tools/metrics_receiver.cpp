@@ -0,0 +1,100 @@
+// Reference receiver for UnixSocketSink: accepts connections on a Unix domain socket,
+// decodes length-prefixed binary batches and prints them in the metrics.log text format.
+
+#include "../include/format.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Larger frames are treated as a corrupt or hostile stream instead of being allocated.
+constexpr size_t kMaxFrameSize = 64 << 20;
+
+bool ReadExact(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = read(fd, data, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void ServeConnection(int fd) {
+    metrics::FrameHeader header;
+    std::string payload;
+    std::vector<metrics::MetricSnapshot> batch;
+
+    while (ReadExact(fd, header.data(), header.size())) {
+        size_t size = metrics::DecodeFrameHeader(header);
+        if (size > kMaxFrameSize) {
+            std::cerr << "frame of " << size << " bytes exceeds the limit, closing connection" << std::endl;
+            return;
+        }
+        payload.resize(size);
+        if (!ReadExact(fd, payload.data(), payload.size())) {
+            return;
+        }
+        if (!metrics::DecodeBinary(payload, batch)) {
+            std::cerr << "malformed batch of " << payload.size() << " bytes" << std::endl;
+            continue;
+        }
+        metrics::WriteTextLine(std::cout, batch);
+        std::cout.flush();
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <socket_path>" << std::endl;
+        return 1;
+    }
+
+    std::string path = argv[1];
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "socket path is too long" << std::endl;
+        return 1;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(path.c_str());
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd, 16) != 0) {
+        std::cerr << "cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    std::cerr << "listening on " << path << std::endl;
+    while (true) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        ServeConnection(fd);
+        close(fd);
+    }
+
+    close(listen_fd);
+    unlink(path.c_str());
+    return 0;
+}